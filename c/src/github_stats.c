@@ -1,15 +1,77 @@
 #define _CRT_SECURE_NO_WARNINGS
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <sys/stat.h>
 
 #include <curl/curl.h>
+#include <pthread.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "template_fields.h"
+#include "index_template.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #ifndef _MSC_VER
 #define _strdup strdup
 #endif
 
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#define make_dir(path) _mkdir(path)
+#define process_id() _getpid()
+#define sync_file(fp) _commit(_fileno(fp))
+#define replace_file(from, to) (MoveFileExA((from), (to), MOVEFILE_REPLACE_EXISTING) ? 0 : -1)
+#define sleep_seconds(seconds) Sleep((DWORD)(seconds) * 1000)
+#define utc_time(clock, out) gmtime_s((out), (clock))
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define make_dir(path) mkdir(path, 0755)
+#define process_id() getpid()
+#define sync_file(fp) fsync(fileno(fp))
+#define replace_file(from, to) rename((from), (to))
+#define sleep_seconds(seconds) sleep(seconds)
+#define utc_time(clock, out) gmtime_r((clock), (out))
+#endif
+
+#ifdef __linux__
+#include <netdb.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#define HAVE_EPOLL 1
+#endif
+
 /* ----------------------------- JSON parsing ----------------------------- */
 
 typedef enum {
@@ -55,6 +117,7 @@ typedef struct {
 
 static void json_skip_ws(JsonParser *parser);
 static JsonValue *json_parse_value(JsonParser *parser);
+static void json_free(JsonValue *value);
 
 static void *xmalloc(size_t size) {
     void *ptr = malloc(size);
@@ -379,11 +442,13 @@ static JsonValue *json_parse(const char *text) {
     JsonValue *value = json_parse_value(&parser);
     if (!value || parser.error[0]) {
         fprintf(stderr, "JSON parse error: %s\n", parser.error[0] ? parser.error : "unknown");
+        json_free(value);
         return NULL;
     }
     json_skip_ws(&parser);
     if (*parser.cur != '\0') {
         fprintf(stderr, "JSON parse error: trailing characters\n");
+        json_free(value);
         return NULL;
     }
     return value;
@@ -470,64 +535,399 @@ static JsonValue *json_array_get(const JsonValue *value, size_t index) {
 typedef struct {
     char *data;
     size_t size;
+    size_t capacity;
 } MemoryBuffer;
 
-static size_t write_memory_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    MemoryBuffer *mem = (MemoryBuffer *)userp;
-    char *ptr = (char *)realloc(mem->data, mem->size + realsize + 1);
+static void buffer_reserve(MemoryBuffer *mem, size_t extra) {
+    if (mem->size + extra + 1 <= mem->capacity) return;
+    size_t capacity = mem->capacity ? mem->capacity : 256;
+    while (capacity < mem->size + extra + 1) {
+        capacity *= 2;
+    }
+    char *ptr = (char *)realloc(mem->data, capacity);
     if (!ptr) {
         fprintf(stderr, "Out of memory\n");
-        return 0;
+        exit(EXIT_FAILURE);
     }
     mem->data = ptr;
-    memcpy(&(mem->data[mem->size]), contents, realsize);
-    mem->size += realsize;
+    mem->capacity = capacity;
+}
+
+static void buffer_append(MemoryBuffer *mem, const char *data, size_t length) {
+    buffer_reserve(mem, length);
+    memcpy(mem->data + mem->size, data, length);
+    mem->size += length;
+    mem->data[mem->size] = '\0';
+}
+
+static void buffer_append_str(MemoryBuffer *mem, const char *text) {
+    buffer_append(mem, text, strlen(text));
+}
+
+static void buffer_appendf(MemoryBuffer *mem, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    va_list copy;
+    va_copy(copy, args);
+    int needed = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if (needed > 0) {
+        buffer_reserve(mem, (size_t)needed);
+        vsnprintf(mem->data + mem->size, (size_t)needed + 1, format, args);
+        mem->size += (size_t)needed;
+    }
+    va_end(args);
+}
+
+/* Number formatting for the render path. vsnprintf parses its format
+ * string and consults the locale on every call, which dominated rendering
+ * long contribution series and large tables; these emit two digits per
+ * step from a table instead. */
+static const char DIGIT_PAIRS[201] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+/* Writes value so that it ends just before end; returns its first digit. */
+static char *format_digits(unsigned long long value, char *end) {
+    while (value >= 100) {
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + (value % 100) * 2, 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + value * 2, 2);
+    } else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+/* Formats value like "%lld" into out, which needs 21 bytes, and returns the
+ * length. No terminator is written. */
+static size_t format_int(long long value, char *out) {
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    char *start = format_digits(magnitude, end);
+    if (value < 0) *--start = '-';
+    size_t length = (size_t)(end - start);
+    memcpy(out, start, length);
+    return length;
+}
+
+/* Formats value like "%.*f" with 0 to 2 decimals into out, which needs 32
+ * bytes, and returns the length. The mantissa is scaled in integers, so
+ * rounding is exact and ties go to even as in printf; only a negative value
+ * that rounds to zero loses its sign. */
+static size_t format_fixed(double value, int decimals, char *out) {
+    static const uint64_t scales[3] = {1, 10, 100};
+    if (!(value > -9e13 && value < 9e13)) {
+        int written = snprintf(out, 32, "%.*f", decimals, value);
+        return written < 0 ? 0 : (size_t)written < 32 ? (size_t)written : 31;
+    }
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int negative = (int)(bits >> 63);
+    int exponent = (int)((bits >> 52) & 0x7ff);
+    uint64_t mantissa = bits & ((1ULL << 52) - 1);
+    if (exponent) {
+        mantissa |= 1ULL << 52;
+    } else {
+        exponent = 1;
+    }
+    exponent -= 1075;
+    /* Below 2^53 * 100, so the product cannot overflow. */
+    uint64_t product = mantissa * scales[decimals];
+    unsigned long long whole = 0;
+    if (exponent >= 0) {
+        whole = product << exponent;
+    } else if (exponent > -64) {
+        int shift = -exponent;
+        uint64_t rest = product & ((1ULL << shift) - 1);
+        uint64_t half = 1ULL << (shift - 1);
+        whole = product >> shift;
+        if (rest > half || (rest == half && (whole & 1))) whole++;
+    }
+
+    char digits[32];
+    char *end = digits + sizeof(digits);
+    char *start = end;
+    if (negative && whole == 0) negative = 0;
+    for (int i = 0; i < decimals; ++i) {
+        *--start = (char)('0' + whole % 10);
+        whole /= 10;
+    }
+    if (decimals > 0) *--start = '.';
+    start = format_digits(whole, start);
+    if (negative) *--start = '-';
+    size_t length = (size_t)(end - start);
+    memcpy(out, start, length);
+    return length;
+}
+
+static void buffer_append_int(MemoryBuffer *mem, long long value) {
+    buffer_reserve(mem, 21);
+    mem->size += format_int(value, mem->data + mem->size);
     mem->data[mem->size] = '\0';
+}
+
+static void buffer_append_fixed(MemoryBuffer *mem, double value, int decimals) {
+    buffer_reserve(mem, 32);
+    mem->size += format_fixed(value, decimals, mem->data + mem->size);
+    mem->data[mem->size] = '\0';
+}
+
+/* Appends text as a quoted JSON string literal. */
+static void buffer_append_json_string(MemoryBuffer *mem, const char *text) {
+    buffer_append(mem, "\"", 1);
+    for (const char *p = text; *p; ++p) {
+        unsigned char ch = (unsigned char)*p;
+        switch (ch) {
+            case '"': buffer_append(mem, "\\\"", 2); break;
+            case '\\': buffer_append(mem, "\\\\", 2); break;
+            case '\n': buffer_append(mem, "\\n", 2); break;
+            case '\r': buffer_append(mem, "\\r", 2); break;
+            case '\t': buffer_append(mem, "\\t", 2); break;
+            default:
+                if (ch < 0x20) {
+                    buffer_appendf(mem, "\\u%04x", ch);
+                } else {
+                    buffer_append(mem, (const char *)p, 1);
+                }
+                break;
+        }
+    }
+    buffer_append(mem, "\"", 1);
+}
+
+/* Milliseconds on a clock that never jumps, for --deadline. */
+static long long monotonic_ms(void) {
+#ifdef _WIN32
+    return (long long)GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
+
+static size_t write_memory_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    MemoryBuffer *mem = (MemoryBuffer *)userp;
+    buffer_append(mem, (const char *)contents, realsize);
     return realsize;
 }
 
-static char *http_post_json(const char *url, const char *token, const char *payload) {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
+/* Response bodies land in buffers owned by the client and are reused by the
+ * next request, so once they have grown to fit a typical response a
+ * long-lived client stops allocating for them. */
+typedef struct {
+    CURL *curl;
+    CURLM *multi;
+    struct curl_slist *headers;
+    MemoryBuffer response;
+    CURL **handles;          /* http_post_json_many pool, duplicated lazily */
+    MemoryBuffer *responses;
+    size_t pool_size;
+    long long deadline; /* monotonic_ms() time every request must end by, 0 for none */
+} HttpClient;
+
+static int http_client_init(HttpClient *client, const char *token) {
+    memset(client, 0, sizeof(*client));
+    client->curl = curl_easy_init();
+    if (!client->curl) {
         fprintf(stderr, "Failed to initialise libcurl\n");
-        return NULL;
+        return -1;
     }
 
-    MemoryBuffer buffer = {0};
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Accept: application/vnd.github+json");
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    client->headers = curl_slist_append(client->headers, "Accept: application/vnd.github+json");
+    client->headers = curl_slist_append(client->headers, "Content-Type: application/json");
 
     char auth_header[256];
     snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", token);
-    headers = curl_slist_append(headers, auth_header);
-    headers = curl_slist_append(headers, "User-Agent: auto-website-c-client");
+    client->headers = curl_slist_append(client->headers, auth_header);
+    client->headers = curl_slist_append(client->headers, "User-Agent: auto-website-c-client");
+
+    curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, client->headers);
+    curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, write_memory_callback);
+    curl_easy_setopt(client->curl, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(client->curl, CURLOPT_NOSIGNAL, 1L);
+    return 0;
+}
+
+static void http_client_cleanup(HttpClient *client) {
+    for (size_t i = 0; i < client->pool_size; ++i) {
+        if (client->handles[i]) curl_easy_cleanup(client->handles[i]);
+        free(client->responses[i].data);
+    }
+    free(client->handles);
+    free(client->responses);
+    client->handles = NULL;
+    client->responses = NULL;
+    client->pool_size = 0;
+    free(client->response.data);
+    client->response.data = NULL;
+    client->response.capacity = 0;
+    if (client->multi) {
+        curl_multi_cleanup(client->multi);
+        client->multi = NULL;
+    }
+    if (client->curl) {
+        curl_easy_cleanup(client->curl);
+        client->curl = NULL;
+    }
+    curl_slist_free_all(client->headers);
+    client->headers = NULL;
+}
 
+/* Caps a request at the time left before the client's deadline. Returns -1
+ * once the deadline has passed. */
+static int http_limit_to_deadline(const HttpClient *client, CURL *handle) {
+    if (!client->deadline) return 0;
+    long long left = client->deadline - monotonic_ms();
+    if (left <= 0) return -1;
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, (long)left);
+    return 0;
+}
+
+/* Reuses the client's easy handle so keep-alive connections and TLS state
+ * survive between calls. The body belongs to the client and stays valid
+ * until its next request. */
+static const char *http_post_json(HttpClient *client, const char *url, const char *payload) {
+    MemoryBuffer *buffer = &client->response;
+    CURL *curl = client->curl;
+
+    buffer->size = 0;
+    if (http_limit_to_deadline(client, curl) != 0) {
+        fprintf(stderr, "Deadline passed; request not sent\n");
+        return NULL;
+    }
     curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_memory_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&buffer);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)buffer);
 
     CURLcode res = curl_easy_perform(curl);
     long response_code = 0;
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-
     if (res != CURLE_OK) {
         fprintf(stderr, "Request failed: %s\n", curl_easy_strerror(res));
-        free(buffer.data);
         return NULL;
     }
     if (response_code != 200) {
-        fprintf(stderr, "GitHub API returned status %ld: %s\n", response_code, buffer.data ? buffer.data : "<empty>");
-        free(buffer.data);
+        fprintf(stderr, "GitHub API returned status %ld: %s\n", response_code, buffer->size ? buffer->data : "<empty>");
         return NULL;
     }
-    return buffer.data;
+    return buffer->size ? buffer->data : "";
+}
+
+/* Requests allowed in flight at once from one client. With HTTP/2 they are
+ * multiplexed over a single connection. */
+#define HTTP_MAX_PARALLEL 16
+
+/* Creates the client's multi handle on first use. */
+static CURLM *http_client_multi(HttpClient *client) {
+    if (!client->multi) {
+        client->multi = curl_multi_init();
+        if (!client->multi) {
+            fprintf(stderr, "Failed to initialise libcurl multi handle\n");
+            return NULL;
+        }
+        curl_multi_setopt(client->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)HTTP_MAX_PARALLEL);
+        curl_multi_setopt(client->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    }
+    return client->multi;
+}
+
+/* The body of a transfer the multi handle reports as done, or NULL (after
+ * saying why) if it failed. */
+static const char *http_finished_body(const CURLMsg *msg, const MemoryBuffer *buffer) {
+    long response_code = 0;
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &response_code);
+    if (msg->data.result != CURLE_OK) {
+        fprintf(stderr, "Request failed: %s\n", curl_easy_strerror(msg->data.result));
+        return NULL;
+    }
+    if (response_code != 200) {
+        fprintf(stderr, "GitHub API returned status %ld: %s\n", response_code, buffer->size ? buffer->data : "<empty>");
+        return NULL;
+    }
+    return buffer->size ? buffer->data : "";
+}
+
+/* Posts every payload concurrently on the client's multi handle and stores
+ * each response body (or NULL on failure) in responses[i]. The multi handle,
+ * its easy handles and their buffers are kept on the client, so the
+ * connection cache survives between calls and a repeat of the same fan-out
+ * allocates nothing. Bodies stay valid until the client's next request. */
+static void http_post_json_many(HttpClient *client, const char *url, char *const *payloads, size_t count, const char **responses) {
+    for (size_t i = 0; i < count; ++i) responses[i] = NULL;
+    if (!http_client_multi(client)) {
+        return;
+    }
+    if (client->deadline && client->deadline <= monotonic_ms()) {
+        fprintf(stderr, "Deadline passed; %zu requests not sent\n", count);
+        return;
+    }
+    if (count > client->pool_size) {
+        CURL **handles = (CURL **)realloc(client->handles, count * sizeof(CURL *));
+        MemoryBuffer *buffers = handles ? (MemoryBuffer *)realloc(client->responses, count * sizeof(MemoryBuffer)) : NULL;
+        if (!buffers) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(handles + client->pool_size, 0, (count - client->pool_size) * sizeof(CURL *));
+        memset(buffers + client->pool_size, 0, (count - client->pool_size) * sizeof(MemoryBuffer));
+        client->handles = handles;
+        client->responses = buffers;
+        client->pool_size = count;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!client->handles[i]) client->handles[i] = curl_easy_duphandle(client->curl);
+        CURL *handle = client->handles[i];
+        if (!handle || http_limit_to_deadline(client, handle) != 0) continue;
+        client->responses[i].size = 0;
+        curl_easy_setopt(handle, CURLOPT_URL, url);
+        curl_easy_setopt(handle, CURLOPT_POSTFIELDS, payloads[i]);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, (void *)&client->responses[i]);
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, (void *)&client->responses[i]);
+        curl_multi_add_handle(client->multi, handle);
+    }
+
+    int running = 0;
+    do {
+        CURLMcode mc = curl_multi_perform(client->multi, &running);
+        if (mc == CURLM_OK && running) {
+            mc = curl_multi_poll(client->multi, NULL, 0, 1000, NULL);
+        }
+        if (mc != CURLM_OK) {
+            fprintf(stderr, "Request failed: %s\n", curl_multi_strerror(mc));
+            break;
+        }
+    } while (running);
+
+    CURLMsg *msg;
+    int pending;
+    while ((msg = curl_multi_info_read(client->multi, &pending))) {
+        if (msg->msg != CURLMSG_DONE) continue;
+        MemoryBuffer *buffer = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&buffer);
+        responses[buffer - client->responses] = http_finished_body(msg, buffer);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (client->handles[i]) curl_multi_remove_handle(client->multi, client->handles[i]);
+    }
+}
+
+static const char *graphql_endpoint(void) {
+    const char *url = getenv("GITHUB_GRAPHQL_URL");
+    if (!url || strlen(url) == 0) {
+        return "https://api.github.com/graphql";
+    }
+    return url;
 }
 
 /* ----------------------------- Data structs ----------------------------- */
@@ -560,18 +960,59 @@ typedef struct {
     size_t capacity;
 } RepoList;
 
+/* Dense daily series: counts[i] is the contribution count on day
+ * start_day + i (days since 1970-01-01). Gaps are zero-filled. */
+typedef struct {
+    int start_day;
+    int *counts;
+    size_t size;
+    size_t capacity;
+} ContributionList;
+
+/* Daily totals decoded column-wise from the history store. Each language
+ * column holds one value per row (zero where the language was absent). */
+typedef struct {
+    char *name;
+    long long *bytes;
+} HistoryLanguage;
+
+typedef struct {
+    int *days;
+    int *stars;
+    int *forks;
+    int *followers;
+    int *contributions;
+    int *public_repos;
+    size_t rows;
+    size_t row_capacity;
+    HistoryLanguage *languages;
+    size_t language_count;
+    size_t language_capacity;
+} History;
+
+typedef enum {
+    CONTEXT_USER,
+    CONTEXT_ORG,
+    CONTEXT_TEAM
+} ContextKind;
+
+/* Weekly buckets in each team member's sparkline. */
+#define TEAM_SPARKLINE_WEEKS 26
+
 typedef struct {
-    char *date;
-    int count;
-} ContributionPoint;
+    char *login;
+    int total_contributions;
+    int weeks[TEAM_SPARKLINE_WEEKS]; /* oldest first */
+} TeamMember;
 
 typedef struct {
-    ContributionPoint *items;
+    TeamMember *items;
     size_t size;
     size_t capacity;
-} ContributionList;
+} TeamMemberList;
 
 typedef struct {
+    ContextKind kind;
     char *login;
     char *name;
     char *avatar_url;
@@ -588,8 +1029,14 @@ typedef struct {
     RepoList top_repos;
     LanguageList languages;
     ContributionList contributions;
+    History history;
+    TeamMemberList members; /* team dashboards only */
+    int stale;              /* STALE_* for data that is not from this run */
 } Context;
 
+#define STALE_ALL 0x01           /* everything came from the last snapshot */
+#define STALE_CONTRIBUTIONS 0x02 /* some calendar years could not be fetched */
+
 static void language_list_init(LanguageList *list) {
     list->items = NULL;
     list->size = 0;
@@ -635,34 +1082,160 @@ static void repo_list_push(RepoList *list, RepoEntry entry) {
     list->items[list->size++] = entry;
 }
 
+static void repo_entry_free(RepoEntry *repo) {
+    free(repo->name);
+    free(repo->description);
+    free(repo->language);
+    free(repo->url);
+    free(repo->updated_at);
+}
+
 static void contribution_list_init(ContributionList *list) {
-    list->items = NULL;
+    list->start_day = 0;
+    list->counts = NULL;
     list->size = 0;
     list->capacity = 0;
 }
 
-static void contribution_list_push(ContributionList *list, const char *date, int count) {
+static void contribution_list_reserve(ContributionList *list, size_t size) {
+    if (size <= list->capacity) return;
+    size_t capacity = list->capacity ? list->capacity : 64;
+    while (capacity < size) capacity *= 2;
+    list->counts = (int *)realloc(list->counts, capacity * sizeof(int));
+    if (!list->counts) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    list->capacity = capacity;
+}
+
+/* Widens the series to cover [first, last], zero-filling new days. */
+static void contribution_list_cover(ContributionList *list, int first, int last) {
+    if (list->size == 0) {
+        contribution_list_reserve(list, (size_t)(last - first + 1));
+        memset(list->counts, 0, (size_t)(last - first + 1) * sizeof(int));
+        list->start_day = first;
+        list->size = (size_t)(last - first + 1);
+        return;
+    }
+    int end = list->start_day + (int)list->size - 1;
+    if (first < list->start_day) {
+        size_t shift = (size_t)(list->start_day - first);
+        contribution_list_reserve(list, list->size + shift);
+        memmove(list->counts + shift, list->counts, list->size * sizeof(int));
+        memset(list->counts, 0, shift * sizeof(int));
+        list->start_day = first;
+        list->size += shift;
+    }
+    if (last > end) {
+        size_t grow = (size_t)(last - end);
+        contribution_list_reserve(list, list->size + grow);
+        memset(list->counts + list->size, 0, grow * sizeof(int));
+        list->size += grow;
+    }
+}
+
+static void contribution_list_set(ContributionList *list, int day, int count) {
+    contribution_list_cover(list, day, day);
+    list->counts[day - list->start_day] = count;
+}
+
+/* Adds src into dst day by day. Both series are dense, so once dst covers
+ * src's range the merge is a single contiguous add the compiler vectorizes;
+ * no per-date lookups are involved. */
+static void contribution_list_add(ContributionList *dst, const ContributionList *src) {
+    if (src->size == 0) return;
+    contribution_list_cover(dst, src->start_day, src->start_day + (int)src->size - 1);
+    int *restrict out = dst->counts + (src->start_day - dst->start_day);
+    const int *restrict in = src->counts;
+    for (size_t i = 0; i < src->size; ++i) {
+        out[i] += in[i];
+    }
+}
+
+static void team_member_push(TeamMemberList *list, TeamMember member) {
     if (list->size == list->capacity) {
-        list->capacity = list->capacity ? list->capacity * 2 : 32;
-        list->items = (ContributionPoint *)realloc(list->items, list->capacity * sizeof(ContributionPoint));
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->items = (TeamMember *)realloc(list->items, list->capacity * sizeof(TeamMember));
         if (!list->items) {
             fprintf(stderr, "Out of memory\n");
             exit(EXIT_FAILURE);
         }
     }
-    list->items[list->size].date = _strdup(date);
-    list->items[list->size].count = count;
-    list->size += 1;
+    list->items[list->size++] = member;
+}
+
+static void context_init(Context *ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    repo_list_init(&ctx->top_repos);
+    language_list_init(&ctx->languages);
+    contribution_list_init(&ctx->contributions);
+}
+
+/* Day numbers count days since 1970-01-01 in the proleptic Gregorian
+ * calendar (Howard Hinnant's civil_from_days algorithms). */
+static int days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void civil_from_days(int z, int *y, int *m, int *d) {
+    z += 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp + (mp < 10 ? 3 : -9);
+    *y = yoe + era * 400 + (*m <= 2);
+}
+
+/* Parses the leading YYYY-MM-DD of text into a day number. */
+static int parse_iso_day(const char *text, int *day) {
+    int y, m, d;
+    if (!text || sscanf(text, "%4d-%2d-%2d", &y, &m, &d) != 3) return -1;
+    if (m < 1 || m > 12 || d < 1 || d > 31) return -1;
+    *day = days_from_civil(y, m, d);
+    return 0;
+}
+
+static void format_iso_day(int day, char out[11]) {
+    int y, m, d;
+    civil_from_days(day, &y, &m, &d);
+    /* The modulo only bounds the year to four digits; real dates fit. */
+    unsigned year = (unsigned)y % 10000u;
+    memcpy(out, DIGIT_PAIRS + year / 100 * 2, 2);
+    memcpy(out + 2, DIGIT_PAIRS + year % 100 * 2, 2);
+    out[4] = '-';
+    memcpy(out + 5, DIGIT_PAIRS + (unsigned)m % 100u * 2, 2);
+    out[7] = '-';
+    memcpy(out + 8, DIGIT_PAIRS + (unsigned)d % 100u * 2, 2);
+    out[10] = '\0';
+}
+
+static void history_free(History *history) {
+    free(history->days);
+    free(history->stars);
+    free(history->forks);
+    free(history->followers);
+    free(history->contributions);
+    free(history->public_repos);
+    for (size_t i = 0; i < history->language_count; ++i) {
+        free(history->languages[i].name);
+        free(history->languages[i].bytes);
+    }
+    free(history->languages);
+    memset(history, 0, sizeof(*history));
 }
 
 static void free_context(Context *ctx) {
     for (size_t i = 0; i < ctx->top_repos.size; ++i) {
-        RepoEntry *repo = &ctx->top_repos.items[i];
-        free(repo->name);
-        free(repo->description);
-        free(repo->language);
-        free(repo->url);
-        free(repo->updated_at);
+        repo_entry_free(&ctx->top_repos.items[i]);
     }
     free(ctx->top_repos.items);
 
@@ -671,17 +1244,56 @@ static void free_context(Context *ctx) {
     }
     free(ctx->languages.items);
 
-    for (size_t i = 0; i < ctx->contributions.size; ++i) {
-        free(ctx->contributions.items[i].date);
+    free(ctx->contributions.counts);
+
+    free(ctx->login);
+    free(ctx->name);
+    free(ctx->avatar_url);
+    free(ctx->bio);
+    free(ctx->location);
+    free(ctx->blog);
+    history_free(&ctx->history);
+
+    for (size_t i = 0; i < ctx->members.size; ++i) {
+        free(ctx->members.items[i].login);
     }
-    free(ctx->contributions.items);
+    free(ctx->members.items);
+}
 
+/* Releases what ctx's data owns but keeps its list storage, so loading the
+ * next fetch into it only allocates when that data outgrows the last. */
+static void context_recycle(Context *ctx) {
+    RepoList repos = ctx->top_repos;
+    LanguageList languages = ctx->languages;
+    ContributionList contributions = ctx->contributions;
+    TeamMemberList members = ctx->members;
+    for (size_t i = 0; i < repos.size; ++i) {
+        repo_entry_free(&repos.items[i]);
+    }
+    for (size_t i = 0; i < languages.size; ++i) {
+        free(languages.items[i].language);
+    }
+    for (size_t i = 0; i < members.size; ++i) {
+        free(members.items[i].login);
+    }
     free(ctx->login);
     free(ctx->name);
     free(ctx->avatar_url);
     free(ctx->bio);
     free(ctx->location);
     free(ctx->blog);
+    history_free(&ctx->history);
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->top_repos = repos;
+    ctx->languages = languages;
+    ctx->contributions = contributions;
+    ctx->members = members;
+    ctx->top_repos.size = 0;
+    ctx->languages.size = 0;
+    ctx->contributions.size = 0;
+    ctx->contributions.start_day = 0;
+    ctx->members.size = 0;
 }
 
 static char *dup_or_empty(const char *value) {
@@ -701,73 +1313,207 @@ static int compare_repos(const void *lhs, const void *rhs) {
     return strcmp(a->name, b->name);
 }
 
+#define TOP_REPO_LIMIT 6
+
+/* Keeps list sorted by compare_repos() and no longer than limit. The
+ * candidate's strings are borrowed and only duplicated if it makes the cut,
+ * so streaming thousands of repositories through allocates for the few that
+ * are kept. */
+static void repo_top_insert(RepoList *list, const RepoEntry *candidate, size_t limit) {
+    if (list->size == limit && compare_repos(candidate, &list->items[list->size - 1]) >= 0) {
+        return;
+    }
+    size_t pos = list->size;
+    while (pos > 0 && compare_repos(candidate, &list->items[pos - 1]) < 0) {
+        pos--;
+    }
+    if (list->size == limit) {
+        repo_entry_free(&list->items[list->size - 1]);
+        list->size -= 1;
+    }
+    RepoEntry entry;
+    entry.name = dup_or_empty(candidate->name);
+    entry.description = dup_or_empty(candidate->description);
+    entry.language = dup_or_empty(candidate->language);
+    entry.url = dup_or_empty(candidate->url);
+    entry.updated_at = dup_or_empty(candidate->updated_at);
+    entry.stars = candidate->stars;
+    entry.forks = candidate->forks;
+    repo_list_push(list, entry);
+    memmove(&list->items[pos + 1], &list->items[pos], (list->size - 1 - pos) * sizeof(RepoEntry));
+    list->items[pos] = entry;
+}
+
 /* ---------------------------- GraphQL payload --------------------------- */
 
-static char *build_graphql_payload(const char *username) {
-    const char *query =
-        "query ($login: String!) {\n"
+#define GRAPHQL_REPO_PAGE 100
+#define GRAPHQL_LANGUAGE_PAGE 10
+
+/* GitHub rejects any query whose connections could return more than 500,000
+ * nodes in total. One user costs the repository page plus a language page
+ * for every repository in it. */
+#define GRAPHQL_NODE_LIMIT 500000
+#define GRAPHQL_USER_NODES (GRAPHQL_REPO_PAGE + GRAPHQL_REPO_PAGE * GRAPHQL_LANGUAGE_PAGE)
+
+/* Rate-limit cost is one point per 100 connection requests. A user issues
+ * the repository connection, one language connection per repository and
+ * three totalCount connections. Batches are kept under a per-query point
+ * budget so one request never eats a large slice of the hourly allowance or
+ * trips GitHub's per-request timeout. */
+#define GRAPHQL_USER_REQUESTS (1 + GRAPHQL_REPO_PAGE + 3)
+#define GRAPHQL_POINT_BUDGET 50
+#define GRAPHQL_DEFAULT_BATCH 25
+
+#define GRAPHQL_STRINGIFY_(x) #x
+#define GRAPHQL_STRINGIFY(x) GRAPHQL_STRINGIFY_(x)
+
+static const char *const REPO_FIELDS_FRAGMENT =
+    "fragment RepoFields on Repository {\n"
+    "  name\n"
+    "  description\n"
+    "  stargazerCount\n"
+    "  forkCount\n"
+    "  url\n"
+    "  updatedAt\n"
+    "  isFork\n"
+    "  primaryLanguage { name }\n"
+    "  languages(first: " GRAPHQL_STRINGIFY(GRAPHQL_LANGUAGE_PAGE) ", orderBy: {field: SIZE, direction: DESC}) {\n"
+    "    edges { size node { name } }\n"
+    "  }\n"
+    "}\n";
+
+static const char *const USER_FIELDS_FRAGMENT =
+    "fragment UserFields on User {\n"
+    "  login\n"
+    "  name\n"
+    "  avatarUrl\n"
+    "  bio\n"
+    "  location\n"
+    "  websiteUrl\n"
+    "  followers { totalCount }\n"
+    "  following { totalCount }\n"
+    "  repositoriesTotal: repositories(ownerAffiliations: OWNER, privacy: PUBLIC) { totalCount }\n"
+    "  repositories(first: " GRAPHQL_STRINGIFY(GRAPHQL_REPO_PAGE) ", ownerAffiliations: OWNER, privacy: PUBLIC, orderBy: {field: STARGAZERS, direction: DESC}) {\n"
+    "    nodes { ...RepoFields }\n"
+    "  }\n"
+    "  contributionsCollection {\n"
+    "    contributionCalendar {\n"
+    "      totalContributions\n"
+    "      weeks {\n"
+    "        contributionDays { date contributionCount }\n"
+    "      }\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+/* GitHub logins are 1-39 alphanumerics or single hyphens; anything else is
+ * rejected so a login can be inlined into a query and used directly as an
+ * output directory name. */
+static int is_valid_login(const char *login) {
+    size_t length = strlen(login);
+    if (length == 0 || length > 39 || login[0] == '-') return 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (!isalnum((unsigned char)login[i]) && login[i] != '-') return 0;
+    }
+    return 1;
+}
+
+/* Largest number of users one aliased query may carry, clamped to both the
+ * node limit and the per-query point budget. */
+static size_t graphql_batch_capacity(size_t requested) {
+    size_t by_nodes = GRAPHQL_NODE_LIMIT / GRAPHQL_USER_NODES;
+    size_t by_cost = (GRAPHQL_POINT_BUDGET * 100) / GRAPHQL_USER_REQUESTS;
+    size_t capacity = requested;
+    if (capacity > by_nodes) capacity = by_nodes;
+    if (capacity > by_cost) capacity = by_cost;
+    return capacity ? capacity : 1;
+}
+
+/* Packs several users into one query as u0: user(login: "a"), u1: ...
+ * Logins must already have passed is_valid_login(), so they can be inlined
+ * without escaping. */
+static char *build_batch_graphql_payload(char *const *logins, size_t count) {
+    MemoryBuffer query = {0};
+    buffer_append_str(&query, "query {\n");
+    for (size_t i = 0; i < count; ++i) {
+        buffer_appendf(&query, "  u%zu: user(login: \"%s\") { ...UserFields }\n", i, logins[i]);
+    }
+    buffer_append_str(&query, "}\n");
+    buffer_append_str(&query, USER_FIELDS_FRAGMENT);
+    buffer_append_str(&query, REPO_FIELDS_FRAGMENT);
+
+    MemoryBuffer payload = {0};
+    buffer_append_str(&payload, "{\"query\":");
+    buffer_append_json_string(&payload, query.data);
+    buffer_append_str(&payload, "}");
+    free(query.data);
+    return payload.data;
+}
+
+/* contributionsCollection only spans one year, so older years are fetched
+ * with one explicit from/to window each. */
+static char *build_year_graphql_payload(const char *login, int from_day, int to_day) {
+    char from[11];
+    char to[11];
+    format_iso_day(from_day, from);
+    format_iso_day(to_day, to);
+
+    MemoryBuffer payload = {0};
+    buffer_append_str(&payload, "{\"query\":");
+    buffer_append_json_string(&payload,
+        "query ($login: String!, $from: DateTime!, $to: DateTime!) {\n"
         "  user(login: $login) {\n"
+        "    contributionsCollection(from: $from, to: $to) {\n"
+        "      contributionCalendar {\n"
+        "        totalContributions\n"
+        "        weeks { contributionDays { date contributionCount } }\n"
+        "      }\n"
+        "    }\n"
+        "  }\n"
+        "}\n");
+    buffer_append_str(&payload, ",\"variables\":{\"login\":");
+    buffer_append_json_string(&payload, login);
+    buffer_appendf(&payload, ",\"from\":\"%sT00:00:00Z\",\"to\":\"%sT23:59:59Z\"}}", from, to);
+    return payload.data;
+}
+
+/* One page of an organization's public repositories. Profile fields are
+ * cheap scalars and are simply re-read on every page. */
+static char *build_org_graphql_payload(const char *org, const char *cursor) {
+    MemoryBuffer query = {0};
+    buffer_append_str(&query,
+        "query ($login: String!, $cursor: String) {\n"
+        "  organization(login: $login) {\n"
         "    login\n"
         "    name\n"
         "    avatarUrl\n"
-        "    bio\n"
+        "    description\n"
         "    location\n"
         "    websiteUrl\n"
-        "    followers { totalCount }\n"
-        "    following { totalCount }\n"
-        "    repositoriesTotal: repositories(ownerAffiliations: OWNER, privacy: PUBLIC) { totalCount }\n"
-        "    repositories(first: 100, ownerAffiliations: OWNER, privacy: PUBLIC, orderBy: {field: STARGAZERS, direction: DESC}) {\n"
-        "      nodes {\n"
-        "        name\n"
-        "        description\n"
-        "        stargazerCount\n"
-        "        forkCount\n"
-        "        url\n"
-        "        updatedAt\n"
-        "        isFork\n"
-        "        primaryLanguage { name }\n"
-        "        languages(first: 10, orderBy: {field: SIZE, direction: DESC}) {\n"
-        "          edges { size node { name } }\n"
-        "        }\n"
-        "      }\n"
-        "    }\n"
-        "    contributionsCollection {\n"
-        "      contributionCalendar {\n"
-        "        totalContributions\n"
-        "        weeks {\n"
-        "          contributionDays { date contributionCount }\n"
-        "        }\n"
-        "      }\n"
+        "    membersWithRole { totalCount }\n"
+        "    repositories(first: " GRAPHQL_STRINGIFY(GRAPHQL_REPO_PAGE) ", after: $cursor, privacy: PUBLIC) {\n"
+        "      totalCount\n"
+        "      pageInfo { hasNextPage endCursor }\n"
+        "      nodes { ...RepoFields }\n"
         "    }\n"
         "  }\n"
-        "}\n";
-
-    size_t payload_size = strlen(query) + strlen(username) + 128;
-    char *payload = (char *)xmalloc(payload_size);
-    snprintf(payload, payload_size, "{\"query\":\"%s\",\"variables\":{\"login\":\"%s\"}}", query, username);
-
-    /* Replace newline characters with escaped sequence */
-    size_t len = strlen(payload);
-    size_t extra = 0;
-    for (size_t i = 0; i < len; ++i) {
-        if (payload[i] == '\n') extra++;
-    }
-    if (extra) {
-        char *expanded = (char *)xmalloc(len + extra + 1);
-        size_t j = 0;
-        for (size_t i = 0; i < len; ++i) {
-            if (payload[i] == '\n') {
-                expanded[j++] = '\\';
-                expanded[j++] = 'n';
-            } else {
-                expanded[j++] = payload[i];
-            }
-        }
-        expanded[j] = '\0';
-        free(payload);
-        payload = expanded;
+        "}\n");
+    buffer_append_str(&query, REPO_FIELDS_FRAGMENT);
+
+    MemoryBuffer payload = {0};
+    buffer_append_str(&payload, "{\"query\":");
+    buffer_append_json_string(&payload, query.data);
+    buffer_append_str(&payload, ",\"variables\":{\"login\":");
+    buffer_append_json_string(&payload, org);
+    buffer_append_str(&payload, ",\"cursor\":");
+    if (cursor) {
+        buffer_append_json_string(&payload, cursor);
+    } else {
+        buffer_append_str(&payload, "null");
     }
-    return payload;
+    buffer_append_str(&payload, "}}");
+    free(query.data);
+    return payload.data;
 }
 
 /* ---------------------------- Data extraction --------------------------- */
@@ -800,23 +1546,14 @@ static void extract_contributions(ContributionList *list, const JsonValue *calen
         for (size_t j = 0; j < daysVal->as.array.size; ++j) {
             JsonValue *day = daysVal->as.array.items[j];
             if (!day || day->type != JSON_OBJECT) continue;
-            const char *date = json_get_string(json_object_get(day, "date"), "");
+            int dayNumber;
+            if (parse_iso_day(json_get_string(json_object_get(day, "date"), ""), &dayNumber) != 0) continue;
             int count = (int)json_get_number(json_object_get(day, "contributionCount"), 0.0);
-            contribution_list_push(list, date, count);
+            contribution_list_set(list, dayNumber, count);
         }
     }
 }
 
-static void trim_contributions(ContributionList *list, size_t maxCount) {
-    if (list->size <= maxCount) return;
-    size_t offset = list->size - maxCount;
-    for (size_t i = 0; i < offset; ++i) {
-        free(list->items[i].date);
-    }
-    memmove(list->items, list->items + offset, (list->size - offset) * sizeof(ContributionPoint));
-    list->size -= offset;
-}
-
 static void compute_language_shares(LanguageList *list) {
     long long total = 0;
     for (size_t i = 0; i < list->size; ++i) {
@@ -839,309 +1576,5357 @@ static int compare_languages(const void *lhs, const void *rhs) {
     return strcmp(a->language, b->language);
 }
 
-static char *html_escape(const char *text) {
-    size_t length = strlen(text);
-    size_t capacity = length + 1;
-    char *buffer = (char *)xmalloc(capacity);
-    size_t idx = 0;
-    for (size_t i = 0; i < length; ++i) {
-        char ch = text[i];
-        const char *replacement = NULL;
-        switch (ch) {
-            case '&': replacement = "&amp;"; break;
-            case '<': replacement = "&lt;"; break;
-            case '>': replacement = "&gt;"; break;
-            case '"': replacement = "&quot;"; break;
-            default: break;
-        }
-        if (replacement) {
-            size_t repLen = strlen(replacement);
-            if (idx + repLen + 1 > capacity) {
-                capacity = (capacity + repLen + 16) * 2;
-                buffer = (char *)realloc(buffer, capacity);
-                if (!buffer) {
-                    fprintf(stderr, "Out of memory\n");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            memcpy(buffer + idx, replacement, repLen);
-            idx += repLen;
-        } else {
-            if (idx + 2 > capacity) {
-                capacity = (capacity + 16) * 2;
-                buffer = (char *)realloc(buffer, capacity);
-                if (!buffer) {
-                    fprintf(stderr, "Out of memory\n");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            buffer[idx++] = ch;
-        }
-    }
-    buffer[idx] = '\0';
-    return buffer;
-}
+/* ---------------------------- Context assembly -------------------------- */
 
-static void write_language_json(FILE *fp, const LanguageList *languages) {
-    fprintf(fp, "[");
-    for (size_t i = 0; i < languages->size; ++i) {
-        const LanguageEntry *entry = &languages->items[i];
-        if (i > 0) fprintf(fp, ",");
-        fprintf(fp, "{\"language\":\"%s\",\"share\":%.2f,\"bytes\":%lld}", entry->language, entry->share, entry->bytes);
+/* Folds one repository node into the running totals, language bytes and
+ * top-repository list without keeping the node itself. */
+static void context_add_repo(Context *ctx, const JsonValue *repo) {
+    if (!repo || repo->type != JSON_OBJECT) return;
+    if (json_get_bool(json_object_get(repo, "isFork"), 0)) {
+        return;
     }
-    fprintf(fp, "]");
+    RepoEntry candidate;
+    candidate.name = (char *)json_get_string(json_object_get(repo, "name"), "");
+    candidate.description = (char *)json_get_string(json_object_get(repo, "description"), "");
+    candidate.language = (char *)json_get_string(json_object_get(json_object_get(repo, "primaryLanguage"), "name"), "Unknown");
+    candidate.url = (char *)json_get_string(json_object_get(repo, "url"), "");
+    candidate.updated_at = (char *)json_get_string(json_object_get(repo, "updatedAt"), "");
+    candidate.stars = (int)json_get_number(json_object_get(repo, "stargazerCount"), 0);
+    candidate.forks = (int)json_get_number(json_object_get(repo, "forkCount"), 0);
+    ctx->total_stars += candidate.stars;
+    ctx->total_forks += candidate.forks;
+    repo_top_insert(&ctx->top_repos, &candidate, TOP_REPO_LIMIT);
+
+    JsonValue *languageVal = json_object_get(repo, "languages");
+    extract_languages(&ctx->languages, languageVal);
 }
 
-static void write_contribution_json(FILE *fp, const ContributionList *contribs) {
-    fprintf(fp, "[");
-    for (size_t i = 0; i < contribs->size; ++i) {
-        if (i > 0) fprintf(fp, ",");
-        fprintf(fp, "{\"date\":\"%s\",\"count\":%d}", contribs->items[i].date, contribs->items[i].count);
+static void context_load_user(Context *ctx, const JsonValue *userVal, const char *username) {
+    ctx->login = dup_or_empty(json_get_string(json_object_get(userVal, "login"), username));
+    ctx->name = dup_or_empty(json_get_string(json_object_get(userVal, "name"), ctx->login));
+    ctx->avatar_url = dup_or_empty(json_get_string(json_object_get(userVal, "avatarUrl"), ""));
+    ctx->bio = dup_or_empty(json_get_string(json_object_get(userVal, "bio"), ""));
+    ctx->location = dup_or_empty(json_get_string(json_object_get(userVal, "location"), ""));
+    ctx->blog = dup_or_empty(json_get_string(json_object_get(userVal, "websiteUrl"), ""));
+    ctx->followers = (int)json_get_number(json_object_get(json_object_get(userVal, "followers"), "totalCount"), 0);
+    ctx->following = (int)json_get_number(json_object_get(json_object_get(userVal, "following"), "totalCount"), 0);
+    ctx->public_repos = (int)json_get_number(json_object_get(json_object_get(userVal, "repositoriesTotal"), "totalCount"), 0);
+
+    JsonValue *reposVal = json_object_get(json_object_get(userVal, "repositories"), "nodes");
+    for (size_t i = 0; i < json_array_size(reposVal); ++i) {
+        context_add_repo(ctx, json_array_get(reposVal, i));
     }
-    fprintf(fp, "]");
+
+    JsonValue *calendar = json_object_get(json_object_get(userVal, "contributionsCollection"), "contributionCalendar");
+    ctx->total_contributions = (int)json_get_number(json_object_get(calendar, "totalContributions"), 0);
+    extract_contributions(&ctx->contributions, calendar);
 }
 
-static void write_html(const Context *ctx, const char *output_path) {
-    FILE *fp = fopen(output_path, "w");
-    if (!fp) {
-        perror("fopen");
-        return;
-    }
+static void context_finalize(Context *ctx) {
+    compute_language_shares(&ctx->languages);
+    qsort(ctx->languages.items, ctx->languages.size, sizeof(LanguageEntry), compare_languages);
 
-    char *nameEsc = html_escape(ctx->name);
-    char *loginEsc = html_escape(ctx->login);
-    char *bioEsc = html_escape(ctx->bio);
-    char *locationEsc = html_escape(ctx->location);
-    char *blogEsc = html_escape(ctx->blog);
-    char *avatarEsc = html_escape(ctx->avatar_url);
-
-    fprintf(fp, "<!DOCTYPE html>\n");
-    fprintf(fp, "<html lang=\"en\">\n<head>\n");
-    fprintf(fp, "    <meta charset=\"utf-8\">\n");
-    fprintf(fp, "    <meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">\n");
-    fprintf(fp, "    <meta name=\"description\" content=\"Live GitHub statistics for %s (@%s). Updated daily via GitHub Actions.\">\n", nameEsc, loginEsc);
-    fprintf(fp, "    <title>%s · GitHub Insights</title>\n", nameEsc);
-    fprintf(fp, "    <link rel=\"preconnect\" href=\"https://fonts.googleapis.com\">\n");
-    fprintf(fp, "    <link rel=\"preconnect\" href=\"https://fonts.gstatic.com\" crossorigin>\n");
-    fprintf(fp, "    <link href=\"https://fonts.googleapis.com/css2?family=Inter:wght@400;500;600;700&display=swap\" rel=\"stylesheet\">\n");
-    fprintf(fp, "    <link rel=\"stylesheet\" href=\"assets/styles.css\">\n");
-    fprintf(fp, "    <script defer src=\"https://cdn.jsdelivr.net/npm/chart.js@4.4.0/dist/chart.umd.min.js\"></script>\n");
-    fprintf(fp, "</head>\n<body>\n");
-
-    fprintf(fp, "    <header class=\"hero\">\n        <div class=\"hero__avatar\">\n            <img src=\"%s\" alt=\"%s avatar\" loading=\"lazy\">\n        </div>\n        <div>\n            <h1>%s</h1>\n            <p class=\"hero__handle\">@%s</p>\n", avatarEsc, nameEsc, nameEsc, loginEsc);
-    if (strlen(ctx->bio) > 0) {
-        fprintf(fp, "            <p class=\"hero__tagline\">%s</p>\n", bioEsc);
-    }
-    fprintf(fp, "            <div class=\"hero__meta\">\n");
-    if (strlen(ctx->location) > 0) {
-        fprintf(fp, "                <span>📍 %s</span>\n", locationEsc);
-    }
-    if (strlen(ctx->blog) > 0) {
-        fprintf(fp, "                <span>🔗 <a href=\"%s\" target=\"_blank\" rel=\"noopener\">%s</a></span>\n", blogEsc, blogEsc);
-    }
-    fprintf(fp, "            </div>\n        </div>\n    </header>\n");
-
-    fprintf(fp, "    <main>\n");
-    fprintf(fp, "        <section class=\"stats-grid\" aria-label=\"Key metrics\">\n");
-    fprintf(fp, "            <article class=\"stat-card\"><h2>Total Stars</h2><p class=\"stat-card__value\">%d</p><p class=\"stat-card__hint\">Across public repositories</p></article>\n", ctx->total_stars);
-    fprintf(fp, "            <article class=\"stat-card\"><h2>Followers</h2><p class=\"stat-card__value\">%d</p><p class=\"stat-card__hint\">On GitHub</p></article>\n", ctx->followers);
-    fprintf(fp, "            <article class=\"stat-card\"><h2>Repositories</h2><p class=\"stat-card__value\">%d</p><p class=\"stat-card__hint\">Public projects</p></article>\n", ctx->public_repos);
-    fprintf(fp, "            <article class=\"stat-card\"><h2>Contributions</h2><p class=\"stat-card__value\">%d</p><p class=\"stat-card__hint\">Past 365 days</p></article>\n", ctx->total_contributions);
-    fprintf(fp, "            <article class=\"stat-card\"><h2>Total Forks</h2><p class=\"stat-card__value\">%d</p><p class=\"stat-card__hint\">Across top repos</p></article>\n", ctx->total_forks);
-    fprintf(fp, "            <article class=\"stat-card\"><h2>Following</h2><p class=\"stat-card__value\">%d</p><p class=\"stat-card__hint\">Developers tracked</p></article>\n", ctx->following);
-    fprintf(fp, "        </section>\n");
-
-    fprintf(fp, "        <section class=\"panel\" aria-label=\"Language breakdown\">\n            <div class=\"panel__header\">\n                <h2>Language Footprint</h2>\n                <p>Distribution across public repositories (top %zu languages).</p>\n            </div>\n            <div class=\"panel__body panel__body--chart\">\n", ctx->languages.size);
-    if (ctx->languages.size == 0) {
-        fprintf(fp, "                <p>No language information available yet.</p>\n");
-    } else {
-        fprintf(fp, "                <canvas id=\"languageChart\" width=\"600\" height=\"320\" role=\"img\" aria-label=\"Language usage chart\"></canvas>\n");
-        fprintf(fp, "                <table class=\"language-table\">\n                    <thead>\n                        <tr><th scope=\"col\">Language</th><th scope=\"col\">Share</th><th scope=\"col\">Source bytes</th></tr>\n                    </thead>\n                    <tbody>\n");
-        for (size_t i = 0; i < ctx->languages.size; ++i) {
-            const LanguageEntry *entry = &ctx->languages.items[i];
-            char *langEsc = html_escape(entry->language);
-            fprintf(fp, "                        <tr><th scope=\"row\">%s</th><td>%.2f%%</td><td>%lld</td></tr>\n", langEsc, entry->share, entry->bytes);
-            free(langEsc);
+    /* Batch workers finalize in parallel, so not gmtime()'s shared buffer. */
+    time_t now = time(NULL);
+    struct tm utc;
+    utc_time(&now, &utc);
+    strftime(ctx->generated_at, sizeof(ctx->generated_at), "%Y-%m-%d %H:%M UTC", &utc);
+}
+
+static void report_graphql_error(const JsonValue *root, const char *alias, const char *login) {
+    JsonValue *errorsVal = json_object_get(root, "errors");
+    for (size_t i = 0; i < json_array_size(errorsVal); ++i) {
+        JsonValue *error = json_array_get(errorsVal, i);
+        const char *head = json_get_string(json_array_get(json_object_get(error, "path"), 0), "");
+        if (strcmp(head, alias) == 0) {
+            fprintf(stderr, "GitHub API error for %s: %s\n", login, json_get_string(json_object_get(error, "message"), "unknown error"));
+            return;
         }
-        fprintf(fp, "                    </tbody>\n                </table>\n");
     }
-    fprintf(fp, "            </div>\n        </section>\n");
+    fprintf(stderr, "GitHub API response missing user data for %s.\n", login);
+}
 
-    fprintf(fp, "        <section class=\"panel\" aria-label=\"Contribution activity\">\n            <div class=\"panel__header\">\n                <h2>Contribution Trend</h2>\n                <p>Commits, pull requests, issues, and reviews across the last %zu days.</p>\n            </div>\n            <div class=\"panel__body panel__body--chart\">\n", ctx->contributions.size);
-    if (ctx->contributions.size == 0) {
-        fprintf(fp, "                <p>No contribution data available.</p>\n");
+/* Window of the k-th year before the default calendar (k >= 1). The
+ * default calendar ends today and reaches back a little over 365 days, so
+ * consecutive windows overlap it slightly; overlapping days carry the same
+ * counts and simply overwrite each other when merged. */
+static void contribution_year_window(int today, int k, int *from_day, int *to_day) {
+    *to_day = today - 365 * k;
+    *from_day = *to_day - 364;
+}
+
+/* Requests behind one aliased batch of count users: the batch query, then
+ * one calendar per user for each year beyond the first. */
+static size_t user_batch_request_count(size_t count, int years) {
+    return 1 + count * (years > 1 ? (size_t)(years - 1) : 0);
+}
+
+/* Builds the user_batch_request_count() payloads for logins, in the order
+ * parse_user_batch() expects their responses. */
+static void build_user_batch_payloads(char *const *logins, size_t count, int years, char **payloads) {
+    size_t extra = years > 1 ? (size_t)(years - 1) : 0;
+    int today = (int)(time(NULL) / 86400);
+    payloads[0] = build_batch_graphql_payload(logins, count);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t k = 1; k <= extra; ++k) {
+            int from_day, to_day;
+            contribution_year_window(today, (int)k, &from_day, &to_day);
+            payloads[1 + i * extra + (k - 1)] = build_year_graphql_payload(logins[i], from_day, to_day);
+        }
+    }
+}
+
+/* Splits the responses to build_user_batch_payloads() (NULL where a request
+ * failed) back out into contexts[i], which must be initialized or recycled
+ * and empty; ok[i] is set for every context that was filled. The caller
+ * frees all of them either way. Returns -1 only if the batch query itself
+ * failed. */
+static int parse_user_batch(char *const *logins, size_t count, int years, const char *const *responses, Context *contexts, int *ok) {
+    for (size_t i = 0; i < count; ++i) {
+        ok[i] = 0;
+    }
+    size_t extra = years > 1 ? (size_t)(years - 1) : 0;
+    JsonValue *root = responses[0] ? json_parse(responses[0]) : NULL;
+    if (!root) {
+        return -1;
+    }
+
+    JsonValue *dataVal = json_object_get(root, "data");
+    for (size_t i = 0; i < count; ++i) {
+        char alias[32];
+        snprintf(alias, sizeof(alias), "u%zu", i);
+        JsonValue *userVal = json_object_get(dataVal, alias);
+        if (!userVal || userVal->type != JSON_OBJECT) {
+            report_graphql_error(root, alias, logins[i]);
+            continue;
+        }
+        context_load_user(&contexts[i], userVal, logins[i]);
+        ok[i] = 1;
+    }
+    json_free(root);
+
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t k = 1; k <= extra; ++k) {
+            const char *response = responses[1 + i * extra + (k - 1)];
+            if (!ok[i]) continue;
+            JsonValue *yearRoot = response ? json_parse(response) : NULL;
+            JsonValue *userVal = json_object_get(json_object_get(yearRoot, "data"), "user");
+            JsonValue *calendar = json_object_get(json_object_get(userVal, "contributionsCollection"), "contributionCalendar");
+            if (calendar && calendar->type == JSON_OBJECT) {
+                extract_contributions(&contexts[i].contributions, calendar);
+            } else {
+                fprintf(stderr, "Missing contribution year %zu for %s; history will have a gap\n", k, logins[i]);
+                contexts[i].stale |= STALE_CONTRIBUTIONS;
+            }
+            json_free(yearRoot);
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (ok[i]) {
+            context_finalize(&contexts[i]);
+        }
+    }
+    return 0;
+}
+
+/* Fetches count users with a single aliased query and splits data.u<i> back
+ * out into contexts[i], as parse_user_batch() describes. When years > 1,
+ * the extra per-year calendars for every user go out on the same multi
+ * handle at the same time, so the wall time is one round trip regardless
+ * of how many years are requested. */
+static int fetch_user_batch(HttpClient *client, char *const *logins, size_t count, int years, Context *contexts, int *ok) {
+    size_t total = user_batch_request_count(count, years);
+    char **payloads = (char **)xmalloc(total * sizeof(char *));
+    const char **responses = (const char **)xmalloc(total * sizeof(char *));
+    build_user_batch_payloads(logins, count, years, payloads);
+    if (total == 1) {
+        responses[0] = http_post_json(client, graphql_endpoint(), payloads[0]);
+    } else {
+        http_post_json_many(client, graphql_endpoint(), payloads, total, responses);
+    }
+    for (size_t i = 0; i < total; ++i) {
+        free(payloads[i]);
+    }
+    free(payloads);
+    int status = parse_user_batch(logins, count, years, responses, contexts, ok);
+    free(responses);
+    return status;
+}
+
+/* Fetches, parses and finalizes one user's dashboard data. Returns 0 on
+ * success; on failure the context is left untouched. */
+static int fetch_user_context(HttpClient *client, const char *username, int years, Context *ctx) {
+    char *logins[1];
+    int ok = 0;
+    logins[0] = (char *)username;
+    context_init(ctx);
+    if (fetch_user_batch(client, logins, 1, years, ctx, &ok) != 0 || !ok) {
+        free_context(ctx);
+        return -1;
+    }
+    return 0;
+}
+
+/* Re-fetches the last year of ctx's calendar, the part of a user's data a
+ * push changes, and merges it over the days already held. */
+static int fetch_recent_contributions(HttpClient *client, Context *ctx) {
+    int today = (int)(time(NULL) / 86400);
+    char *payload = build_year_graphql_payload(ctx->login, today - 364, today);
+    const char *response = http_post_json(client, graphql_endpoint(), payload);
+    free(payload);
+    JsonValue *root = response ? json_parse(response) : NULL;
+    JsonValue *userVal = json_object_get(json_object_get(root, "data"), "user");
+    JsonValue *calendar = json_object_get(json_object_get(userVal, "contributionsCollection"), "contributionCalendar");
+    int status = -1;
+    if (calendar && calendar->type == JSON_OBJECT) {
+        extract_contributions(&ctx->contributions, calendar);
+        ctx->total_contributions = (int)json_get_number(json_object_get(calendar, "totalContributions"), ctx->total_contributions);
+        status = 0;
+    }
+    json_free(root);
+    return status;
+}
+
+/* Maximum pages walked for one organization (100 repositories each). */
+#define ORG_MAX_PAGES 1000
+
+/* Walks every page of an organization's public repositories, folding each
+ * page into ctx as it arrives and releasing it before requesting the next,
+ * so memory stays flat no matter how many repositories the org owns. ctx
+ * must be initialized or recycled and empty; the caller frees it either
+ * way. */
+static int fetch_org_context(HttpClient *client, const char *org, Context *ctx) {
+    ctx->kind = CONTEXT_ORG;
+
+    char *cursor = NULL;
+    for (int page = 0; page < ORG_MAX_PAGES; ++page) {
+        char *payload = build_org_graphql_payload(org, cursor);
+        const char *response = http_post_json(client, graphql_endpoint(), payload);
+        free(payload);
+        if (!response) {
+            goto fail;
+        }
+
+        JsonValue *root = json_parse(response);
+        if (!root) {
+            goto fail;
+        }
+
+        JsonValue *orgVal = json_object_get(json_object_get(root, "data"), "organization");
+        if (!orgVal || orgVal->type != JSON_OBJECT) {
+            report_graphql_error(root, "organization", org);
+            json_free(root);
+            goto fail;
+        }
+
+        JsonValue *reposVal = json_object_get(orgVal, "repositories");
+        if (page == 0) {
+            ctx->login = dup_or_empty(json_get_string(json_object_get(orgVal, "login"), org));
+            ctx->name = dup_or_empty(json_get_string(json_object_get(orgVal, "name"), ctx->login));
+            ctx->avatar_url = dup_or_empty(json_get_string(json_object_get(orgVal, "avatarUrl"), ""));
+            ctx->bio = dup_or_empty(json_get_string(json_object_get(orgVal, "description"), ""));
+            ctx->location = dup_or_empty(json_get_string(json_object_get(orgVal, "location"), ""));
+            ctx->blog = dup_or_empty(json_get_string(json_object_get(orgVal, "websiteUrl"), ""));
+            ctx->followers = (int)json_get_number(json_object_get(json_object_get(orgVal, "membersWithRole"), "totalCount"), 0);
+            ctx->public_repos = (int)json_get_number(json_object_get(reposVal, "totalCount"), 0);
+        }
+
+        JsonValue *nodesVal = json_object_get(reposVal, "nodes");
+        for (size_t i = 0; i < json_array_size(nodesVal); ++i) {
+            context_add_repo(ctx, json_array_get(nodesVal, i));
+        }
+
+        JsonValue *pageInfo = json_object_get(reposVal, "pageInfo");
+        const char *endCursor = json_get_string(json_object_get(pageInfo, "endCursor"), NULL);
+        int hasNext = json_get_bool(json_object_get(pageInfo, "hasNextPage"), 0) && endCursor;
+        free(cursor);
+        cursor = hasNext ? _strdup(endCursor) : NULL;
+        json_free(root);
+        if (!cursor) break;
+    }
+    free(cursor);
+
+    context_finalize(ctx);
+    return 0;
+
+fail:
+    free(cursor);
+    return -1;
+}
+
+/* ------------------------------ File output ----------------------------- */
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+/* 64-bit FNV-1a, continued from hash. */
+static uint64_t fnv1a64(uint64_t hash, const void *data, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static int file_exists(const char *path) {
+    struct stat info;
+    return stat(path, &info) == 0;
+}
+
+/* Creates path and any missing parents. */
+static int ensure_directory(const char *path) {
+    char buffer[1024];
+    size_t length = strlen(path);
+    if (length == 0 || length >= sizeof(buffer)) return -1;
+    memcpy(buffer, path, length + 1);
+    for (size_t i = 1; i <= length; ++i) {
+        if (buffer[i] == '/' || buffer[i] == '\\' || buffer[i] == '\0') {
+            char saved = buffer[i];
+            buffer[i] = '\0';
+            if (make_dir(buffer) != 0 && errno != EEXIST) {
+                perror(buffer);
+                return -1;
+            }
+            buffer[i] = saved;
+        }
+    }
+    return 0;
+}
+
+/* Writes data to a temporary file beside path and renames it into place,
+ * so a crash or a concurrent reader never sees a partially written file.
+ * The temporary name is derived from path, which is unique per writer. */
+static int write_file_atomic(const char *path, const void *data, size_t size) {
+    char temp[1100];
+    snprintf(temp, sizeof(temp), "%s.tmp%ld", path, (long)process_id());
+    FILE *fp = fopen(temp, "wb");
+    if (!fp) {
+        perror(temp);
+        return -1;
+    }
+    size_t written = fwrite(data, 1, size, fp);
+    int flushed = fflush(fp) == 0 && sync_file(fp) == 0;
+    int closed = fclose(fp);
+    if (written != size || !flushed || closed != 0) {
+        fprintf(stderr, "Failed to write %s\n", temp);
+        remove(temp);
+        return -1;
+    }
+    if (replace_file(temp, path) != 0) {
+        perror(path);
+        remove(temp);
+        return -1;
+    }
+    return 0;
+}
+
+/* ------------------------------- Snapshots ------------------------------ */
+
+/* A snapshot is the finalized Context in a versioned, little-endian binary
+ * layout that can be mapped and read in place:
+ *
+ *   SnapshotHeader
+ *   SnapshotRepo[repo_count]
+ *   SnapshotLanguage[language_count]
+ *   SnapshotContribution[contribution_count]
+ *   string table (NUL-terminated strings; offset 0 is the empty string)
+ *
+ * Every section starts on an 8-byte boundary and strings are referenced by
+ * offset into the table. Bump SNAPSHOT_VERSION whenever a record changes. */
+#define SNAPSHOT_MAGIC "GHSS"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t byte_order;
+    uint32_t kind;
+    int32_t followers;
+    int32_t following;
+    int32_t public_repos;
+    int32_t total_stars;
+    int32_t total_forks;
+    int32_t total_contributions;
+    uint32_t login;
+    uint32_t name;
+    uint32_t avatar_url;
+    uint32_t bio;
+    uint32_t location;
+    uint32_t blog;
+    uint32_t generated_at;
+    uint32_t repo_count;
+    uint32_t language_count;
+    uint32_t contribution_count;
+    uint64_t repos_offset;
+    uint64_t languages_offset;
+    uint64_t contributions_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+} SnapshotHeader;
+
+typedef struct {
+    uint32_t name;
+    uint32_t description;
+    uint32_t language;
+    uint32_t url;
+    uint32_t updated_at;
+    int32_t stars;
+    int32_t forks;
+    uint32_t reserved;
+} SnapshotRepo;
+
+typedef struct {
+    uint32_t language;
+    uint32_t reserved;
+    int64_t bytes;
+    double share;
+} SnapshotLanguage;
+
+typedef struct {
+    int32_t day;
+    int32_t count;
+} SnapshotContribution;
+
+static uint32_t snapshot_intern(MemoryBuffer *strings, const char *text) {
+    if (!text || !*text) return 0;
+    uint32_t offset = (uint32_t)strings->size;
+    buffer_append(strings, text, strlen(text) + 1);
+    return offset;
+}
+
+static void buffer_align(MemoryBuffer *mem, size_t alignment) {
+    static const char zeros[8] = {0};
+    size_t pad = (alignment - mem->size % alignment) % alignment;
+    buffer_append(mem, zeros, pad);
+}
+
+static int write_snapshot(const Context *ctx, const char *path) {
+    MemoryBuffer strings = {0};
+    buffer_append(&strings, "", 1);
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+    header.version = SNAPSHOT_VERSION;
+    header.header_size = (uint16_t)sizeof(SnapshotHeader);
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.kind = (uint32_t)ctx->kind;
+    header.followers = ctx->followers;
+    header.following = ctx->following;
+    header.public_repos = ctx->public_repos;
+    header.total_stars = ctx->total_stars;
+    header.total_forks = ctx->total_forks;
+    header.total_contributions = ctx->total_contributions;
+    header.login = snapshot_intern(&strings, ctx->login);
+    header.name = snapshot_intern(&strings, ctx->name);
+    header.avatar_url = snapshot_intern(&strings, ctx->avatar_url);
+    header.bio = snapshot_intern(&strings, ctx->bio);
+    header.location = snapshot_intern(&strings, ctx->location);
+    header.blog = snapshot_intern(&strings, ctx->blog);
+    header.generated_at = snapshot_intern(&strings, ctx->generated_at);
+    header.repo_count = (uint32_t)ctx->top_repos.size;
+    header.language_count = (uint32_t)ctx->languages.size;
+
+    MemoryBuffer file = {0};
+    buffer_append(&file, (const char *)&header, sizeof(header));
+
+    buffer_align(&file, 8);
+    header.repos_offset = file.size;
+    for (size_t i = 0; i < ctx->top_repos.size; ++i) {
+        const RepoEntry *repo = &ctx->top_repos.items[i];
+        SnapshotRepo record;
+        record.name = snapshot_intern(&strings, repo->name);
+        record.description = snapshot_intern(&strings, repo->description);
+        record.language = snapshot_intern(&strings, repo->language);
+        record.url = snapshot_intern(&strings, repo->url);
+        record.updated_at = snapshot_intern(&strings, repo->updated_at);
+        record.stars = repo->stars;
+        record.forks = repo->forks;
+        record.reserved = 0;
+        buffer_append(&file, (const char *)&record, sizeof(record));
+    }
+
+    buffer_align(&file, 8);
+    header.languages_offset = file.size;
+    for (size_t i = 0; i < ctx->languages.size; ++i) {
+        const LanguageEntry *entry = &ctx->languages.items[i];
+        SnapshotLanguage record;
+        record.language = snapshot_intern(&strings, entry->language);
+        record.reserved = 0;
+        record.bytes = entry->bytes;
+        record.share = entry->share;
+        buffer_append(&file, (const char *)&record, sizeof(record));
+    }
+
+    buffer_align(&file, 8);
+    header.contributions_offset = file.size;
+    for (size_t i = 0; i < ctx->contributions.size; ++i) {
+        SnapshotContribution record;
+        record.day = ctx->contributions.start_day + (int32_t)i;
+        record.count = ctx->contributions.counts[i];
+        buffer_append(&file, (const char *)&record, sizeof(record));
+    }
+    header.contribution_count = (uint32_t)ctx->contributions.size;
+
+    buffer_align(&file, 8);
+    header.strings_offset = file.size;
+    header.strings_size = strings.size;
+    buffer_append(&file, strings.data, strings.size);
+    memcpy(file.data, &header, sizeof(header));
+    free(strings.data);
+
+    int status = write_file_atomic(path, file.data, file.size);
+    free(file.data);
+    return status;
+}
+
+/* Read-only view of a whole file: mapped where mmap exists, read into
+ * memory otherwise. */
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    int mapped;
+} FileView;
+
+static int file_view_open(const char *path, FileView *view) {
+    view->data = NULL;
+    view->size = 0;
+    view->mapped = 0;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return -1;
+    }
+    view->data = (const unsigned char *)addr;
+    view->size = (size_t)st.st_size;
+    view->mapped = 1;
+    return 0;
+#else
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return -1;
+    }
+    MemoryBuffer buffer = {0};
+    char chunk[65536];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        buffer_append(&buffer, chunk, got);
+    }
+    fclose(fp);
+    if (buffer.size == 0) {
+        free(buffer.data);
+        return -1;
+    }
+    view->data = (const unsigned char *)buffer.data;
+    view->size = buffer.size;
+    return 0;
+#endif
+}
+
+static void file_view_close(FileView *view) {
+#ifndef _WIN32
+    if (view->mapped) {
+        munmap((void *)view->data, view->size);
+    } else {
+        free((void *)view->data);
+    }
+#else
+    free((void *)view->data);
+#endif
+    view->data = NULL;
+    view->size = 0;
+}
+
+static int snapshot_section_fits(const FileView *view, uint64_t offset, uint64_t count, size_t record_size) {
+    if (offset % 8 != 0 || offset > view->size) return 0;
+    return count <= (view->size - offset) / record_size;
+}
+
+/* GitHub opened in 2008, so no contribution day predates it. */
+#define SNAPSHOT_FIRST_YEAR 2008
+
+/* Counts must be non-negative and days must fall between GitHub's first
+ * year and tomorrow. Otherwise a corrupt file could index before the
+ * percentile histogram, or size the dense calendar from two far-apart
+ * days. */
+static int snapshot_contributions_valid(const SnapshotContribution *records, uint64_t count) {
+    int first = days_from_civil(SNAPSHOT_FIRST_YEAR, 1, 1);
+    int last = (int)(time(NULL) / 86400) + 1;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (records[i].count < 0 || records[i].day < first || records[i].day > last) return 0;
+    }
+    return 1;
+}
+
+/* Returns a string from the table, or "" for an out-of-range offset. The
+ * table is verified to end in NUL, so every in-range offset terminates. */
+static const char *snapshot_string(const char *table, uint64_t table_size, uint32_t offset) {
+    return offset < table_size ? table + offset : "";
+}
+
+static int load_snapshot(const char *path, Context *ctx) {
+    FileView view;
+    if (file_view_open(path, &view) != 0) {
+        fprintf(stderr, "Cannot open snapshot %s\n", path);
+        return -1;
+    }
+
+    SnapshotHeader header;
+    int valid = view.size >= sizeof(header);
+    if (valid) {
+        memcpy(&header, view.data, sizeof(header));
+        valid = memcmp(header.magic, SNAPSHOT_MAGIC, 4) == 0 &&
+                header.version == SNAPSHOT_VERSION &&
+                header.header_size == sizeof(SnapshotHeader) &&
+                header.byte_order == SNAPSHOT_BYTE_ORDER &&
+                snapshot_section_fits(&view, header.repos_offset, header.repo_count, sizeof(SnapshotRepo)) &&
+                snapshot_section_fits(&view, header.languages_offset, header.language_count, sizeof(SnapshotLanguage)) &&
+                snapshot_section_fits(&view, header.contributions_offset, header.contribution_count, sizeof(SnapshotContribution)) &&
+                snapshot_contributions_valid((const SnapshotContribution *)(view.data + header.contributions_offset), header.contribution_count) &&
+                snapshot_section_fits(&view, header.strings_offset, header.strings_size, 1) &&
+                header.strings_size > 0 &&
+                view.data[header.strings_offset + header.strings_size - 1] == '\0';
+    }
+    if (!valid) {
+        fprintf(stderr, "Snapshot %s is corrupt or from an incompatible version\n", path);
+        file_view_close(&view);
+        return -1;
+    }
+
+    const char *table = (const char *)view.data + header.strings_offset;
+    uint64_t table_size = header.strings_size;
+    const SnapshotRepo *repos = (const SnapshotRepo *)(view.data + header.repos_offset);
+    const SnapshotLanguage *languages = (const SnapshotLanguage *)(view.data + header.languages_offset);
+    const SnapshotContribution *contributions = (const SnapshotContribution *)(view.data + header.contributions_offset);
+
+    context_init(ctx);
+    ctx->kind = header.kind == CONTEXT_ORG ? CONTEXT_ORG : CONTEXT_USER;
+    ctx->followers = header.followers;
+    ctx->following = header.following;
+    ctx->public_repos = header.public_repos;
+    ctx->total_stars = header.total_stars;
+    ctx->total_forks = header.total_forks;
+    ctx->total_contributions = header.total_contributions;
+    ctx->login = _strdup(snapshot_string(table, table_size, header.login));
+    ctx->name = _strdup(snapshot_string(table, table_size, header.name));
+    ctx->avatar_url = _strdup(snapshot_string(table, table_size, header.avatar_url));
+    ctx->bio = _strdup(snapshot_string(table, table_size, header.bio));
+    ctx->location = _strdup(snapshot_string(table, table_size, header.location));
+    ctx->blog = _strdup(snapshot_string(table, table_size, header.blog));
+    snprintf(ctx->generated_at, sizeof(ctx->generated_at), "%s", snapshot_string(table, table_size, header.generated_at));
+
+    for (uint32_t i = 0; i < header.repo_count; ++i) {
+        RepoEntry entry;
+        entry.name = _strdup(snapshot_string(table, table_size, repos[i].name));
+        entry.description = _strdup(snapshot_string(table, table_size, repos[i].description));
+        entry.language = _strdup(snapshot_string(table, table_size, repos[i].language));
+        entry.url = _strdup(snapshot_string(table, table_size, repos[i].url));
+        entry.updated_at = _strdup(snapshot_string(table, table_size, repos[i].updated_at));
+        entry.stars = repos[i].stars;
+        entry.forks = repos[i].forks;
+        repo_list_push(&ctx->top_repos, entry);
+    }
+    for (uint32_t i = 0; i < header.language_count; ++i) {
+        language_list_add(&ctx->languages, snapshot_string(table, table_size, languages[i].language), languages[i].bytes);
+        ctx->languages.items[ctx->languages.size - 1].share = languages[i].share;
+    }
+    for (uint32_t i = 0; i < header.contribution_count; ++i) {
+        contribution_list_set(&ctx->contributions, contributions[i].day, contributions[i].count);
+    }
+
+    file_view_close(&view);
+    return 0;
+}
+
+/* The --deadline fallback: the last snapshot, flagged so the page says its
+ * data is not from this run. */
+static int load_stale_context(const char *path, Context *ctx) {
+    if (!file_exists(path) || load_snapshot(path, ctx) != 0) {
+        return -1;
+    }
+    ctx->stale = STALE_ALL;
+    fprintf(stderr, "Refresh failed; rendering %s from the snapshot of %s\n", ctx->login, ctx->generated_at);
+    return 0;
+}
+
+/* Restores calendar years a fresh fetch missed from the last snapshot. Only
+ * days in the extra year windows are taken; those counts no longer change,
+ * so where both sides have a day they agree and the larger one fills a gap. */
+static void context_backfill_contributions(Context *ctx, const char *path) {
+    Context cached;
+    if (!(ctx->stale & STALE_CONTRIBUTIONS) || !path || !file_exists(path) || load_snapshot(path, &cached) != 0) {
+        return;
+    }
+    const ContributionList *old = &cached.contributions;
+    int last = old->start_day + (int)old->size - 1;
+    int from_day, to_day;
+    contribution_year_window((int)(time(NULL) / 86400), 1, &from_day, &to_day);
+    if (last > to_day) last = to_day;
+    if (old->size > 0 && last >= old->start_day) {
+        contribution_list_cover(&ctx->contributions, old->start_day, last);
+        int *counts = ctx->contributions.counts + (old->start_day - ctx->contributions.start_day);
+        for (int i = 0; i <= last - old->start_day; ++i) {
+            if (old->counts[i] > counts[i]) counts[i] = old->counts[i];
+        }
+    }
+    free_context(&cached);
+}
+
+/* ----------------------------- History store ---------------------------- */
+
+/* The history file is an append-only log that is never rewritten:
+ *
+ *   "GHHS" version(1) reserved(3)
+ *   record*
+ *
+ * record := HISTORY_LANGUAGE varint(id) varint(length) bytes
+ *         | HISTORY_ROW varint(day delta) zigzag(stars delta)
+ *           zigzag(forks delta) zigzag(followers delta)
+ *           zigzag(contributions delta) zigzag(public repos delta)
+ *           varint(n) n * (varint(language id) zigzag(bytes delta))
+ *
+ * Every value is stored as the difference from the previous row (languages
+ * missing from a row count as zero), so a day with little movement costs a
+ * few dozen bytes. A row with day delta 0 replaces the previous row, which
+ * lets several runs on one day collapse to the last one. Readers decode the
+ * log straight into per-column arrays. */
+#define HISTORY_MAGIC "GHHS"
+#define HISTORY_VERSION 1
+#define HISTORY_HEADER_SIZE 8
+#define HISTORY_LANGUAGE 0x01
+#define HISTORY_ROW 0x02
+
+static void buffer_append_varint(MemoryBuffer *mem, uint64_t value) {
+    char bytes[10];
+    size_t length = 0;
+    do {
+        unsigned char byte = (unsigned char)(value & 0x7f);
+        value >>= 7;
+        if (value) byte |= 0x80;
+        bytes[length++] = (char)byte;
+    } while (value);
+    buffer_append(mem, bytes, length);
+}
+
+static void buffer_append_zigzag(MemoryBuffer *mem, int64_t value) {
+    buffer_append_varint(mem, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+typedef struct {
+    const unsigned char *cur;
+    const unsigned char *end;
+    int failed;
+} ByteReader;
+
+static uint64_t read_varint(ByteReader *reader) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (reader->cur >= reader->end) break;
+        unsigned char byte = *reader->cur++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    reader->failed = 1;
+    return 0;
+}
+
+static int64_t read_zigzag(ByteReader *reader) {
+    uint64_t value = read_varint(reader);
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static void history_reserve_rows(History *history, size_t rows) {
+    if (rows <= history->row_capacity) return;
+    size_t capacity = history->row_capacity ? history->row_capacity * 2 : 64;
+    while (capacity < rows) capacity *= 2;
+    int **columns[] = {&history->days, &history->stars, &history->forks, &history->followers, &history->contributions, &history->public_repos};
+    for (size_t c = 0; c < sizeof(columns) / sizeof(columns[0]); ++c) {
+        *columns[c] = (int *)realloc(*columns[c], capacity * sizeof(int));
+        if (!*columns[c]) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (size_t i = 0; i < history->language_count; ++i) {
+        history->languages[i].bytes = (long long *)realloc(history->languages[i].bytes, capacity * sizeof(long long));
+        if (!history->languages[i].bytes) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    history->row_capacity = capacity;
+}
+
+static void history_add_language(History *history, const char *name, size_t length) {
+    if (history->language_count == history->language_capacity) {
+        history->language_capacity = history->language_capacity ? history->language_capacity * 2 : 16;
+        history->languages = (HistoryLanguage *)realloc(history->languages, history->language_capacity * sizeof(HistoryLanguage));
+        if (!history->languages) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    HistoryLanguage *language = &history->languages[history->language_count++];
+    language->name = (char *)xmalloc(length + 1);
+    memcpy(language->name, name, length);
+    language->name[length] = '\0';
+    language->bytes = (long long *)calloc(history->row_capacity ? history->row_capacity : 1, sizeof(long long));
+    if (!language->bytes) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static int history_find_language(const History *history, const char *name) {
+    for (size_t i = 0; i < history->language_count; ++i) {
+        if (strcmp(history->languages[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+/* Whether base + delta stays within [low, high], for low <= base <= high.
+ * Only a damaged file moves a column out of range. */
+static int history_sum_fits(long long base, int64_t delta, long long low, long long high) {
+    return delta >= 0 ? delta <= high - base : delta >= low - base;
+}
+
+/* Decodes path into history. A missing file yields an empty history. A
+ * torn final record (e.g. from a crash mid-append) is ignored, and so is
+ * everything from the first malformed record on; valid_size reports how
+ * many bytes decoded cleanly so the writer can cut the tail off before
+ * appending. */
+static int history_load(const char *path, History *history, size_t *valid_size) {
+    memset(history, 0, sizeof(*history));
+    if (valid_size) *valid_size = 0;
+
+    FileView view;
+    if (file_view_open(path, &view) != 0) {
+        return 0;
+    }
+    if (view.size < HISTORY_HEADER_SIZE || memcmp(view.data, HISTORY_MAGIC, 4) != 0 || view.data[4] != HISTORY_VERSION) {
+        fprintf(stderr, "History file %s is not a version %d history store\n", path, HISTORY_VERSION);
+        file_view_close(&view);
+        return -1;
+    }
+
+    ByteReader reader = {view.data + HISTORY_HEADER_SIZE, view.data + view.size, 0};
+    const unsigned char *committed = reader.cur;
+    long long *scratch_bytes = NULL;
+    unsigned char *scratch_seen = NULL;
+    while (reader.cur < reader.end) {
+        unsigned char tag = *reader.cur++;
+        if (tag == HISTORY_LANGUAGE) {
+            uint64_t id = read_varint(&reader);
+            uint64_t length = read_varint(&reader);
+            if (reader.failed || id != history->language_count || length > (uint64_t)(reader.end - reader.cur)) break;
+            history_add_language(history, (const char *)reader.cur, (size_t)length);
+            reader.cur += length;
+            scratch_bytes = (long long *)realloc(scratch_bytes, history->language_count * sizeof(long long));
+            scratch_seen = (unsigned char *)realloc(scratch_seen, history->language_count);
+            if (!scratch_bytes || !scratch_seen) {
+                fprintf(stderr, "Out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+        } else if (tag == HISTORY_ROW) {
+            int64_t deltas[6];
+            deltas[0] = (int64_t)read_varint(&reader);
+            for (int c = 1; c < 6; ++c) {
+                deltas[c] = read_zigzag(&reader);
+            }
+            uint64_t n = read_varint(&reader);
+            if (reader.failed || n > history->language_count) break;
+
+            /* The day is relative to the last row; a zero delta replaces that
+             * row. Values are relative to the row before the one written. */
+            size_t row = history->rows;
+            int previous_day = row ? history->days[row - 1] : 0;
+            if (!history_sum_fits(previous_day, deltas[0], previous_day, INT_MAX)) break;
+            int day = previous_day + (int)deltas[0];
+            if (deltas[0] == 0 && row > 0) {
+                row -= 1;
+            }
+            int fits = 1;
+            int *previous_columns[5] = {history->stars, history->forks, history->followers, history->contributions, history->public_repos};
+            for (int c = 0; c < 5; ++c) {
+                fits &= history_sum_fits(row ? previous_columns[c][row - 1] : 0, deltas[c + 1], INT_MIN, INT_MAX);
+            }
+            if (!fits) break;
+            history_reserve_rows(history, row + 1);
+            for (size_t i = 0; i < history->language_count; ++i) {
+                scratch_seen[i] = 0;
+            }
+            for (uint64_t k = 0; k < n && !reader.failed; ++k) {
+                uint64_t id = read_varint(&reader);
+                int64_t delta = read_zigzag(&reader);
+                if (id >= history->language_count) {
+                    reader.failed = 1;
+                    break;
+                }
+                long long base = row ? history->languages[id].bytes[row - 1] : 0;
+                if (!history_sum_fits(base, delta, 0, LLONG_MAX)) {
+                    reader.failed = 1;
+                    break;
+                }
+                scratch_bytes[id] = base + delta;
+                scratch_seen[id] = 1;
+            }
+            if (reader.failed) break;
+
+            for (size_t i = 0; i < history->language_count; ++i) {
+                history->languages[i].bytes[row] = scratch_seen[i] ? scratch_bytes[i] : 0;
+            }
+            int *columns[5] = {history->stars, history->forks, history->followers, history->contributions, history->public_repos};
+            for (int c = 0; c < 5; ++c) {
+                columns[c][row] = (int)((row ? columns[c][row - 1] : 0) + deltas[c + 1]);
+            }
+            history->days[row] = day;
+            history->rows = row + 1;
+        } else {
+            break;
+        }
+        committed = reader.cur;
+    }
+
+    free(scratch_bytes);
+    free(scratch_seen);
+    if (valid_size) *valid_size = (size_t)(committed - view.data);
+    file_view_close(&view);
+    return 0;
+}
+
+/* Whether ctx has the same totals and languages as the given history row. */
+static int history_row_matches(const History *history, size_t row, const Context *ctx) {
+    if (history->stars[row] != ctx->total_stars || history->forks[row] != ctx->total_forks ||
+        history->followers[row] != ctx->followers || history->contributions[row] != ctx->total_contributions ||
+        history->public_repos[row] != ctx->public_repos) {
+        return 0;
+    }
+    size_t present = 0;
+    for (size_t i = 0; i < ctx->languages.size; ++i) {
+        long long bytes = ctx->languages.items[i].bytes;
+        int id = history_find_language(history, ctx->languages.items[i].language);
+        if ((id < 0 ? 0 : history->languages[id].bytes[row]) != bytes) return 0;
+        present += bytes != 0;
+    }
+    size_t recorded = 0;
+    for (size_t i = 0; i < history->language_count; ++i) {
+        recorded += history->languages[i].bytes[row] != 0;
+    }
+    return recorded == present;
+}
+
+/* Appends today's totals for ctx to the store at path and leaves the full
+ * decoded series (including the new row) in ctx->history. */
+static int history_append(const char *path, Context *ctx) {
+    History *history = &ctx->history;
+    size_t valid_size = 0;
+    history_free(history);
+    if (history_load(path, history, &valid_size) != 0) {
+        return -1;
+    }
+
+    int today = (int)(time(NULL) / 86400);
+    size_t previous = history->rows;
+    int prev_day = previous ? history->days[previous - 1] : 0;
+    if (previous && today < prev_day) {
+        fprintf(stderr, "History %s ends in the future; not appending\n", path);
+        return -1;
+    }
+    /* A row that repeats the latest one adds nothing to the charts and would
+     * make the published page change without any new data. */
+    if (previous && history_row_matches(history, previous - 1, ctx)) {
+        return 0;
+    }
+
+    MemoryBuffer record = {0};
+    if (valid_size == 0) {
+        buffer_append(&record, HISTORY_MAGIC, 4);
+        const char version[4] = {HISTORY_VERSION, 0, 0, 0};
+        buffer_append(&record, version, 4);
+    }
+
+    /* A same-day rerun replaces the last row, so its values are deltas
+     * against the row before that one, mirroring the reader. */
+    size_t base = (previous && today == prev_day) ? previous - 1 : previous;
+    int64_t base_values[5] = {0, 0, 0, 0, 0};
+    if (base) {
+        base_values[0] = history->stars[base - 1];
+        base_values[1] = history->forks[base - 1];
+        base_values[2] = history->followers[base - 1];
+        base_values[3] = history->contributions[base - 1];
+        base_values[4] = history->public_repos[base - 1];
+    }
+
+    int *ids = (int *)xmalloc((ctx->languages.size ? ctx->languages.size : 1) * sizeof(int));
+    for (size_t i = 0; i < ctx->languages.size; ++i) {
+        const char *name = ctx->languages.items[i].language;
+        ids[i] = history_find_language(history, name);
+        if (ids[i] < 0) {
+            size_t length = strlen(name);
+            buffer_append(&record, "\x01", 1);
+            buffer_append_varint(&record, history->language_count);
+            buffer_append_varint(&record, length);
+            buffer_append(&record, name, length);
+            history_add_language(history, name, length);
+            ids[i] = (int)history->language_count - 1;
+        }
+    }
+
+    buffer_append(&record, "\x02", 1);
+    buffer_append_varint(&record, (uint64_t)(today - prev_day));
+    buffer_append_zigzag(&record, ctx->total_stars - base_values[0]);
+    buffer_append_zigzag(&record, ctx->total_forks - base_values[1]);
+    buffer_append_zigzag(&record, ctx->followers - base_values[2]);
+    buffer_append_zigzag(&record, ctx->total_contributions - base_values[3]);
+    buffer_append_zigzag(&record, ctx->public_repos - base_values[4]);
+    buffer_append_varint(&record, ctx->languages.size);
+    for (size_t i = 0; i < ctx->languages.size; ++i) {
+        long long prior = (base && (size_t)ids[i] < history->language_count) ? history->languages[ids[i]].bytes[base - 1] : 0;
+        buffer_append_varint(&record, (uint64_t)ids[i]);
+        buffer_append_zigzag(&record, ctx->languages.items[i].bytes - prior);
+    }
+
+    /* Mirror the new row into the in-memory columns. */
+    size_t row = base;
+    history_reserve_rows(history, row + 1);
+    history->days[row] = today;
+    history->stars[row] = ctx->total_stars;
+    history->forks[row] = ctx->total_forks;
+    history->followers[row] = ctx->followers;
+    history->contributions[row] = ctx->total_contributions;
+    history->public_repos[row] = ctx->public_repos;
+    for (size_t i = 0; i < history->language_count; ++i) {
+        history->languages[i].bytes[row] = 0;
+    }
+    for (size_t i = 0; i < ctx->languages.size; ++i) {
+        history->languages[ids[i]].bytes[row] = ctx->languages.items[i].bytes;
+    }
+    history->rows = row + 1;
+    free(ids);
+
+#ifndef _WIN32
+    if (valid_size > 0 && truncate(path, (off_t)valid_size) != 0) {
+        perror(path);
+        free(record.data);
+        return -1;
+    }
+#endif
+    FILE *fp = fopen(path, "ab");
+    if (!fp) {
+        perror(path);
+        free(record.data);
+        return -1;
+    }
+    size_t written = fwrite(record.data, 1, record.size, fp);
+    int closed = fclose(fp);
+    int complete = written == record.size && closed == 0;
+    free(record.data);
+    if (!complete) {
+        fprintf(stderr, "Failed to append to history %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/* ------------------------- Contribution analytics ----------------------- */
+
+/* Active-day counts up to this value are ranked with a counting histogram;
+ * anything larger falls back to sorting the active days. */
+#define PERCENTILE_HISTOGRAM_LIMIT 4096
+
+typedef struct {
+    long long total;
+    int active_days;
+    int longest_streak;
+    int current_streak;
+    int best_count;
+    int best_day;
+    long long weekday_totals[7]; /* Sunday first */
+    int p25;
+    int p50;
+    int p75;
+    int p90;
+    int p99;
+    long long *prefix; /* prefix[i] = sum of the first i days, size + 1 entries */
+    size_t size;
+} ContributionStats;
+
+static void contribution_stats_free(ContributionStats *stats) {
+    free(stats->prefix);
+    stats->prefix = NULL;
+    stats->size = 0;
+}
+
+static int compare_ints(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentiles over the active (non-zero) days. The quartiles
+ * also bound the heatmap shades. */
+#define CONTRIBUTION_PERCENTILES 5
+
+static void contribution_percentiles(const ContributionList *contribs, ContributionStats *stats) {
+    size_t active = (size_t)stats->active_days;
+    if (active == 0) return;
+    size_t ranks[CONTRIBUTION_PERCENTILES];
+    const int percents[CONTRIBUTION_PERCENTILES] = {25, 50, 75, 90, 99};
+    for (size_t k = 0; k < CONTRIBUTION_PERCENTILES; ++k) {
+        ranks[k] = (active * (size_t)percents[k] + 99) / 100;
+        if (ranks[k] == 0) ranks[k] = 1;
+    }
+    int *out[CONTRIBUTION_PERCENTILES] = {&stats->p25, &stats->p50, &stats->p75, &stats->p90, &stats->p99};
+
+    if (stats->best_count <= PERCENTILE_HISTOGRAM_LIMIT) {
+        size_t *histogram = (size_t *)calloc((size_t)stats->best_count + 1, sizeof(size_t));
+        if (!histogram) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < contribs->size; ++i) {
+            if (contribs->counts[i] > 0) histogram[contribs->counts[i]]++;
+        }
+        size_t seen = 0;
+        size_t k = 0;
+        for (int value = 1; value <= stats->best_count && k < CONTRIBUTION_PERCENTILES; ++value) {
+            seen += histogram[value];
+            while (k < CONTRIBUTION_PERCENTILES && seen >= ranks[k]) *out[k++] = value;
+        }
+        free(histogram);
+        return;
+    }
+
+    int *values = (int *)xmalloc(active * sizeof(int));
+    size_t n = 0;
+    for (size_t i = 0; i < contribs->size; ++i) {
+        if (contribs->counts[i] > 0) values[n++] = contribs->counts[i];
+    }
+    qsort(values, n, sizeof(int), compare_ints);
+    for (size_t k = 0; k < CONTRIBUTION_PERCENTILES; ++k) *out[k] = values[ranks[k] - 1];
+    free(values);
+}
+
+/* One pass over the dense series fills the prefix sums, streaks, weekday
+ * histogram and best day. The loop body is branch-free so it stays cheap
+ * when run over hundreds of merged calendars. */
+static void compute_contribution_stats(const ContributionList *contribs, ContributionStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    size_t n = contribs->size;
+    stats->size = n;
+    stats->prefix = (long long *)xmalloc((n + 1) * sizeof(long long));
+    stats->prefix[0] = 0;
+    if (n == 0) return;
+
+    const int *counts = contribs->counts;
+    long long *prefix = stats->prefix;
+    long long running = 0;
+    int active = 0;
+    int run = 0;
+    int previous_run = 0;
+    int longest = 0;
+    int best = 0;
+    size_t best_index = 0;
+    /* Day 0 (1970-01-01) was a Thursday. */
+    int weekday = ((contribs->start_day % 7) + 11) % 7;
+    for (size_t i = 0; i < n; ++i) {
+        int count = counts[i];
+        int on = count > 0;
+        running += count;
+        prefix[i + 1] = running;
+        active += on;
+        previous_run = run;
+        run = (run + 1) & -on;
+        longest = run > longest ? run : longest;
+        best_index = count > best ? i : best_index;
+        best = count > best ? count : best;
+        stats->weekday_totals[weekday] += count;
+        weekday = weekday == 6 ? 0 : weekday + 1;
+    }
+
+    stats->total = running;
+    stats->active_days = active;
+    stats->longest_streak = longest;
+    /* Today is still in progress, so an empty last day does not break a
+     * streak that ran through yesterday. */
+    stats->current_streak = counts[n - 1] > 0 ? run : previous_run;
+    stats->best_count = best;
+    stats->best_day = contribs->start_day + (int)best_index;
+    contribution_percentiles(contribs, stats);
+}
+
+/* Mean over the window days ending at index end, clipped to the series. */
+static double contribution_window_average(const ContributionStats *stats, size_t end, size_t window) {
+    if (stats->size == 0) return 0.0;
+    size_t start = end + 1 > window ? end + 1 - window : 0;
+    return (double)(stats->prefix[end + 1] - stats->prefix[start]) / (double)(end + 1 - start);
+}
+
+/* Sums the last count * 7 days of the series into weekly buckets, oldest
+ * first. Weeks before the series starts stay zero. */
+static void contribution_weekly_totals(const ContributionList *contribs, int *weeks, size_t count) {
+    memset(weeks, 0, count * sizeof(int));
+    size_t span = count * 7;
+    size_t first = contribs->size > span ? contribs->size - span : 0;
+    for (size_t i = first; i < contribs->size; ++i) {
+        weeks[count - 1 - (contribs->size - 1 - i) / 7] += contribs->counts[i];
+    }
+}
+
+static int contribution_busiest_weekday(const ContributionStats *stats) {
+    int busiest = 0;
+    for (int i = 1; i < 7; ++i) {
+        if (stats->weekday_totals[i] > stats->weekday_totals[busiest]) busiest = i;
+    }
+    return busiest;
+}
+
+/* ----------------------------- HTML rendering --------------------------- */
+
+static const char *html_entity(char ch, size_t *length) {
+    switch (ch) {
+        case '&': *length = 5; return "&amp;";
+        case '<': *length = 4; return "&lt;";
+        case '>': *length = 4; return "&gt;";
+        case '"': *length = 6; return "&quot;";
+        case '\'': *length = 5; return "&#39;";
+        default: return NULL;
+    }
+}
+
+#ifdef HAVE_SSE2
+static unsigned lowest_set_bit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+#endif
+
+/* Appends the first length bytes of text with &<>"' escaped. Clean runs are
+ * copied straight into mem; with SSE2 the scan for special characters looks
+ * at 16 bytes per step, and only the characters that need escaping take the
+ * slow path. Nothing is allocated beyond growing mem itself. */
+static void buffer_append_html_n(MemoryBuffer *mem, const char *text, size_t length) {
+    buffer_reserve(mem, length);
+    size_t run = 0;
+    size_t i = 0;
+#ifdef HAVE_SSE2
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i quot = _mm_set1_epi8('"');
+    const __m128i apos = _mm_set1_epi8('\'');
+    while (i + 16 <= length) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, amp), _mm_cmpeq_epi8(chunk, lt)),
+                                    _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, gt), _mm_cmpeq_epi8(chunk, quot)),
+                                                 _mm_cmpeq_epi8(chunk, apos)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hits);
+        if (mask == 0) {
+            i += 16;
+            continue;
+        }
+        size_t at = i + lowest_set_bit(mask);
+        size_t entity_length = 0;
+        const char *entity = html_entity(text[at], &entity_length);
+        buffer_append(mem, text + run, at - run);
+        buffer_append(mem, entity, entity_length);
+        i = run = at + 1;
+    }
+#endif
+    for (; i < length; ++i) {
+        size_t entity_length = 0;
+        const char *entity = html_entity(text[i], &entity_length);
+        if (!entity) continue;
+        buffer_append(mem, text + run, i - run);
+        buffer_append(mem, entity, entity_length);
+        run = i + 1;
+    }
+    buffer_append(mem, text + run, length - run);
+}
+
+/* Chart data is embedded column-wise, one array per field, and expanded by
+ * the decoders in the page script. Key names are not repeated per row and
+ * dates are stored as one start date plus offsets. */
+static void write_language_json(MemoryBuffer *out, const LanguageList *languages) {
+    buffer_append_str(out, "{\"language\":[");
+    for (size_t i = 0; i < languages->size; ++i) {
+        if (i) buffer_append(out, ",", 1);
+        buffer_append_json_string(out, languages->items[i].language);
+    }
+    buffer_append_str(out, "],\"share\":[");
+    for (size_t i = 0; i < languages->size; ++i) {
+        if (i) buffer_append(out, ",", 1);
+        buffer_append_fixed(out, languages->items[i].share, 2);
+    }
+    buffer_append_str(out, "],\"bytes\":[");
+    for (size_t i = 0; i < languages->size; ++i) {
+        if (i) buffer_append(out, ",", 1);
+        buffer_append_int(out, languages->items[i].bytes);
+    }
+    buffer_append_str(out, "]}");
+}
+
+/* Upper bound for --years. */
+#define MAX_CONTRIBUTION_YEARS 20
+
+/* The trend chart shows only the most recent days of the series. */
+#define CONTRIBUTION_TRAIL_DAYS 120
+
+static size_t contribution_trail_start(const ContributionList *contribs) {
+    return contribs->size > CONTRIBUTION_TRAIL_DAYS ? contribs->size - CONTRIBUTION_TRAIL_DAYS : 0;
+}
+
+/* The trail as daily counts from start. The first skip counts precede the
+ * trail and are there only so the decoder can compute the 7-day average. */
+static void write_contribution_json(MemoryBuffer *out, const ContributionList *contribs) {
+    size_t trail = contribution_trail_start(contribs);
+    size_t first = trail > 6 ? trail - 6 : 0;
+    char date[11];
+    format_iso_day(contribs->start_day + (int)first, date);
+    buffer_appendf(out, "{\"start\":\"%s\",\"skip\":%zu,\"counts\":[", date, trail - first);
+    for (size_t i = first; i < contribs->size; ++i) {
+        if (i > first) buffer_append(out, ",", 1);
+        buffer_append_int(out, contribs->counts[i]);
+    }
+    buffer_append_str(out, "]}");
+}
+
+typedef struct {
+    int from_day;
+    int to_day;
+    long long total;
+} YearWindow;
+
+/* Splits the series into trailing 365-day windows ending on its last day,
+ * newest first. Only windows fully covered by the series are returned. */
+static size_t contribution_year_windows(const ContributionList *contribs, YearWindow *out, size_t max) {
+    size_t count = 0;
+    int last = contribs->start_day + (int)contribs->size - 1;
+    while (count < max) {
+        int to_day = last - 365 * (int)count;
+        int from_day = to_day - 364;
+        if (from_day < contribs->start_day) break;
+        long long total = 0;
+        for (int day = from_day; day <= to_day; ++day) {
+            total += contribs->counts[day - contribs->start_day];
+        }
+        out[count].from_day = from_day;
+        out[count].to_day = to_day;
+        out[count].total = total;
+        count++;
+    }
+    return count;
+}
+
+#define HISTORY_CHART_LANGUAGES 6
+
+/* Picks up to HISTORY_CHART_LANGUAGES languages, largest in the most recent
+ * row first. */
+static size_t history_chart_languages(const History *history, size_t picked[HISTORY_CHART_LANGUAGES]) {
+    size_t last = history->rows - 1;
+    size_t picked_count = 0;
+    for (size_t n = 0; n < HISTORY_CHART_LANGUAGES; ++n) {
+        int best = -1;
+        for (size_t i = 0; i < history->language_count; ++i) {
+            int taken = 0;
+            for (size_t k = 0; k < picked_count; ++k) taken |= picked[k] == i;
+            if (taken || history->languages[i].bytes[last] <= 0) continue;
+            if (best < 0 || history->languages[i].bytes[last] > history->languages[best].bytes[last]) best = (int)i;
+        }
+        if (best < 0) break;
+        picked[picked_count++] = (size_t)best;
+    }
+    return picked_count;
+}
+
+static double history_language_share(const History *history, size_t language, size_t row) {
+    long long total = 0;
+    for (size_t j = 0; j < history->language_count; ++j) {
+        total += history->languages[j].bytes[row];
+    }
+    return total ? (double)history->languages[language].bytes[row] * 100.0 / (double)total : 0.0;
+}
+
+/* Emits the history columns plus per-row share for the charted languages.
+ * Days are gaps from the previous row, starting at 0 for the first. */
+static void write_history_json(MemoryBuffer *out, const History *history) {
+    char date[11];
+    format_iso_day(history->days[0], date);
+    buffer_appendf(out, "{\"start\":\"%s\",\"days\":[", date);
+    for (size_t i = 0; i < history->rows; ++i) {
+        if (i) buffer_append(out, ",", 1);
+        buffer_append_int(out, i ? history->days[i] - history->days[i - 1] : 0);
+    }
+    const char *names[] = {"stars", "forks", "followers"};
+    const int *columns[] = {history->stars, history->forks, history->followers};
+    for (size_t c = 0; c < 3; ++c) {
+        buffer_appendf(out, "],\"%s\":[", names[c]);
+        for (size_t i = 0; i < history->rows; ++i) {
+            if (i) buffer_append(out, ",", 1);
+            buffer_append_int(out, columns[c][i]);
+        }
+    }
+    buffer_append_str(out, "],\"languages\":[");
+
+    size_t picked[HISTORY_CHART_LANGUAGES];
+    size_t picked_count = history_chart_languages(history, picked);
+    for (size_t k = 0; k < picked_count; ++k) {
+        const HistoryLanguage *language = &history->languages[picked[k]];
+        buffer_append_str(out, k ? ",{\"language\":" : "{\"language\":");
+        buffer_append_json_string(out, language->name);
+        buffer_append_str(out, ",\"share\":[");
+        for (size_t i = 0; i < history->rows; ++i) {
+            if (i) buffer_append(out, ",", 1);
+            buffer_append_fixed(out, history_language_share(history, picked[k], i), 2);
+        }
+        buffer_append_str(out, "]}");
+    }
+    buffer_append_str(out, "]}");
+}
+
+/* Charts are drawn here as inline SVG, so they show up with the first paint
+ * and need no script. --chartjs swaps in interactive Chart.js versions of
+ * the same charts once the page has loaded. */
+static const char *CHART_PALETTE[] = {"#5B8FF9", "#5AD8A6", "#5D7092", "#F6BD16", "#E8684A", "#6DC8EC", "#9270CA", "#FF9D4D"};
+#define CHART_PALETTE_SIZE (sizeof(CHART_PALETTE) / sizeof(CHART_PALETTE[0]))
+
+/* Doughnut of the language shares. Every slice is a dash on the same
+ * circle; pathLength="100" makes the dash lengths percentages. */
+static void write_language_svg(MemoryBuffer *out, const LanguageList *languages) {
+    double total = 0.0;
+    for (size_t i = 0; i < languages->size; ++i) {
+        total += languages->items[i].share;
+    }
+    buffer_append_str(out, "<svg viewBox=\"0 0 200 200\" role=\"img\" aria-label=\"Language usage chart\"><g transform=\"rotate(-90 100 100)\">");
+    double offset = 0.0;
+    for (size_t i = 0; i < languages->size; ++i) {
+        const LanguageEntry *entry = &languages->items[i];
+        double part = total > 0.0 ? entry->share * 100.0 / total : 0.0;
+        buffer_appendf(out, "<circle class=\"chart__ring\" cx=\"100\" cy=\"100\" r=\"70\" pathLength=\"100\" stroke=\"%s\" stroke-dasharray=\"%.2f %.2f\" stroke-dashoffset=\"%.2f\"><title>",
+                       CHART_PALETTE[i % CHART_PALETTE_SIZE], part, 100.0 - part, offset > 0.0 ? -offset : 0.0);
+        buffer_append_html_n(out, entry->language, strlen(entry->language));
+        buffer_append(out, " ", 1);
+        buffer_append_fixed(out, entry->share, 2);
+        buffer_append_str(out, "%</title></circle>");
+        offset += part;
+    }
+    buffer_append_str(out, "</g></svg>");
+}
+
+/* Line charts share one 600x240 viewBox: a plot area with gridlines at
+ * zero, half and full scale, labelled on the left, and the first and last
+ * dates underneath. */
+#define SVG_PLOT_LEFT 44.0
+#define SVG_PLOT_TOP 12.0
+#define SVG_PLOT_WIDTH 544.0
+#define SVG_PLOT_HEIGHT 196.0
+/* Longer series are sampled down; a point per two units is already finer
+ * than the chart is drawn. */
+#define SVG_MAX_POINTS 272
+
+/* Rounds up to 1, 2 or 5 times a power of ten so gridlines get round labels. */
+static double svg_scale_max(double max) {
+    double step = 1.0;
+    while (step * 10.0 <= max) step *= 10.0;
+    if (max <= step) return step;
+    if (max <= 2.0 * step) return 2.0 * step;
+    if (max <= 5.0 * step) return 5.0 * step;
+    return 10.0 * step;
+}
+
+static void svg_begin_plot(MemoryBuffer *out, const char *label, double max, int first_day, int last_day) {
+    char first[11];
+    char last[11];
+    format_iso_day(first_day, first);
+    format_iso_day(last_day, last);
+    buffer_appendf(out, "<svg viewBox=\"0 0 600 240\" role=\"img\" aria-label=\"%s\">", label);
+    for (int step = 0; step <= 2; ++step) {
+        double y = SVG_PLOT_TOP + SVG_PLOT_HEIGHT * (1.0 - step / 2.0);
+        double value = max * step / 2.0;
+        buffer_appendf(out, "<line class=\"chart__grid\" x1=\"%.0f\" y1=\"%.1f\" x2=\"%.0f\" y2=\"%.1f\"/>", SVG_PLOT_LEFT, y, SVG_PLOT_LEFT + SVG_PLOT_WIDTH, y);
+        int decimals = value != (double)(long long)value;
+        buffer_appendf(out, "<text x=\"%.0f\" y=\"%.1f\" text-anchor=\"end\">%.*f</text>", SVG_PLOT_LEFT - 6.0, y + 4.0, decimals, value);
+    }
+    double baseline = SVG_PLOT_TOP + SVG_PLOT_HEIGHT + 20.0;
+    buffer_appendf(out, "<text x=\"%.0f\" y=\"%.0f\">%s</text><text x=\"%.0f\" y=\"%.0f\" text-anchor=\"end\">%s</text>",
+                   SVG_PLOT_LEFT, baseline, first, SVG_PLOT_LEFT + SVG_PLOT_WIDTH, baseline, last);
+}
+
+/* Appends path coordinates for values scaled to max, sampled down to
+ * SVG_MAX_POINTS and optionally walked backwards (to close an area). */
+static void svg_append_points(MemoryBuffer *out, const double *values, size_t count, double max, int reverse, const char *command) {
+    size_t points = count < SVG_MAX_POINTS ? count : SVG_MAX_POINTS;
+    for (size_t k = 0; k < points; ++k) {
+        size_t j = reverse ? points - 1 - k : k;
+        size_t i = points > 1 ? j * (count - 1) / (points - 1) : 0;
+        double x = SVG_PLOT_LEFT + (points > 1 ? SVG_PLOT_WIDTH * (double)j / (double)(points - 1) : SVG_PLOT_WIDTH / 2.0);
+        double y = SVG_PLOT_TOP + SVG_PLOT_HEIGHT * (1.0 - (max > 0.0 ? values[i] / max : 0.0));
+        buffer_append_str(out, k == 0 ? command : "L");
+        buffer_append_fixed(out, x, 1);
+        buffer_append(out, ",", 1);
+        buffer_append_fixed(out, y, 1);
+    }
+}
+
+static void svg_line(MemoryBuffer *out, const double *values, size_t count, double max, const char *color) {
+    buffer_append_str(out, "<path class=\"chart__line\" d=\"");
+    svg_append_points(out, values, count, max, 0, "M");
+    buffer_appendf(out, "\" stroke=\"%s\"/>", color);
+}
+
+/* Legend entries laid out right to left along the top edge. */
+static void svg_legend(MemoryBuffer *out, const char *const *labels, const char *const *colors, size_t count) {
+    double x = SVG_PLOT_LEFT + SVG_PLOT_WIDTH;
+    for (size_t i = count; i-- > 0;) {
+        buffer_appendf(out, "<text x=\"%.0f\" y=\"10\" text-anchor=\"end\" fill=\"%s\">", x, colors[i]);
+        buffer_append_html_n(out, labels[i], strlen(labels[i]));
+        buffer_append_str(out, "</text>");
+        x -= 8.0 * (double)strlen(labels[i]) + 16.0;
+    }
+}
+
+static void write_contribution_svg(MemoryBuffer *out, const ContributionList *contribs, const ContributionStats *stats) {
+    size_t start = contribution_trail_start(contribs);
+    size_t count = contribs->size - start;
+    if (count == 0) return;
+    double *counts = (double *)xmalloc(count * sizeof(double));
+    double *average = (double *)xmalloc(count * sizeof(double));
+    double max = 1.0;
+    for (size_t i = 0; i < count; ++i) {
+        counts[i] = contribs->counts[start + i];
+        average[i] = contribution_window_average(stats, start + i, 7);
+        if (counts[i] > max) max = counts[i];
+    }
+    max = svg_scale_max(max);
+    svg_begin_plot(out, "Contribution activity chart", max, contribs->start_day + (int)start, contribs->start_day + (int)contribs->size - 1);
+    buffer_append_str(out, "<path class=\"chart__area\" fill=\"rgba(91, 143, 249, 0.2)\" d=\"");
+    svg_append_points(out, counts, count, max, 0, "M");
+    double bottom = SVG_PLOT_TOP + SVG_PLOT_HEIGHT;
+    buffer_appendf(out, "L%.1f,%.1fL%.1f,%.1fZ\"/>", SVG_PLOT_LEFT + (count > 1 ? SVG_PLOT_WIDTH : SVG_PLOT_WIDTH / 2.0), bottom, SVG_PLOT_LEFT + (count > 1 ? 0.0 : SVG_PLOT_WIDTH / 2.0), bottom);
+    svg_line(out, counts, count, max, CHART_PALETTE[0]);
+    svg_line(out, average, count, max, CHART_PALETTE[3]);
+    const char *labels[] = {"Daily", "7-day average"};
+    const char *colors[] = {CHART_PALETTE[0], CHART_PALETTE[3]};
+    svg_legend(out, labels, colors, 2);
+    buffer_append_str(out, "</svg>");
+    free(counts);
+    free(average);
+}
+
+static void write_history_svg(MemoryBuffer *out, const History *history) {
+    size_t rows = history->rows;
+    double *series[3];
+    const int *columns[] = {history->stars, history->forks, history->followers};
+    double max = 1.0;
+    for (size_t c = 0; c < 3; ++c) {
+        series[c] = (double *)xmalloc(rows * sizeof(double));
+        for (size_t i = 0; i < rows; ++i) {
+            series[c][i] = columns[c][i];
+            if (series[c][i] > max) max = series[c][i];
+        }
+    }
+    max = svg_scale_max(max);
+    svg_begin_plot(out, "Stars, forks and followers over time", max, history->days[0], history->days[rows - 1]);
+    const char *labels[] = {"Stars", "Forks", "Followers"};
+    const char *colors[] = {CHART_PALETTE[0], CHART_PALETTE[1], CHART_PALETTE[3]};
+    for (size_t c = 0; c < 3; ++c) {
+        svg_line(out, series[c], rows, max, colors[c]);
+        free(series[c]);
+    }
+    svg_legend(out, labels, colors, 3);
+    buffer_append_str(out, "</svg>");
+}
+
+/* Stacked language shares: each band runs along its upper edge and back
+ * along the one below it. */
+static void write_language_drift_svg(MemoryBuffer *out, const History *history) {
+    size_t rows = history->rows;
+    size_t picked[HISTORY_CHART_LANGUAGES];
+    size_t picked_count = history_chart_languages(history, picked);
+    double *lower = (double *)xmalloc(rows * sizeof(double));
+    double *upper = (double *)xmalloc(rows * sizeof(double));
+    memset(upper, 0, rows * sizeof(double));
+    svg_begin_plot(out, "Language share over time", 100.0, history->days[0], history->days[rows - 1]);
+    const char *labels[HISTORY_CHART_LANGUAGES];
+    const char *colors[HISTORY_CHART_LANGUAGES];
+    for (size_t k = 0; k < picked_count; ++k) {
+        memcpy(lower, upper, rows * sizeof(double));
+        for (size_t i = 0; i < rows; ++i) {
+            upper[i] += history_language_share(history, picked[k], i);
+        }
+        labels[k] = history->languages[picked[k]].name;
+        colors[k] = CHART_PALETTE[k % CHART_PALETTE_SIZE];
+        buffer_append_str(out, "<path class=\"chart__area\" d=\"");
+        svg_append_points(out, upper, rows, 100.0, 0, "M");
+        svg_append_points(out, lower, rows, 100.0, 1, "L");
+        buffer_appendf(out, "Z\" fill=\"%s\"><title>", colors[k]);
+        buffer_append_html_n(out, labels[k], strlen(labels[k]));
+        buffer_append_str(out, "</title></path>");
+    }
+    svg_legend(out, labels, colors, picked_count);
+    buffer_append_str(out, "</svg>");
+    free(lower);
+    free(upper);
+}
+
+/* Calendar heatmap: weeks run left to right and weekdays top to bottom, in
+ * blocks of 53 weeks ending with the current week, newest block first.
+ * Days are shaded by quartile of the active days. Each shade is a single
+ * dashed path, so a run of equal days in a row is one "M..h.." command
+ * rather than one element per day. */
+#define HEATMAP_WEEKS 53
+#define HEATMAP_CELL 12
+#define HEATMAP_LEFT 30
+#define HEATMAP_BLOCK_HEIGHT (20 + 7 * HEATMAP_CELL)
+#define HEATMAP_LEVELS 5
+
+static int heatmap_level(const ContributionStats *stats, int count) {
+    if (count <= 0) return 0;
+    if (count <= stats->p25) return 1;
+    if (count <= stats->p50) return 2;
+    if (count <= stats->p75) return 3;
+    return 4;
+}
+
+static void heatmap_level_title(MemoryBuffer *out, const ContributionStats *stats, int level) {
+    const int bounds[HEATMAP_LEVELS] = {0, stats->p25, stats->p50, stats->p75, stats->best_count};
+    if (level == 0) {
+        buffer_append_str(out, "No contributions");
+    } else if (level == HEATMAP_LEVELS - 1) {
+        buffer_appendf(out, "%d or more contributions", bounds[level - 1] + 1);
+    } else if (bounds[level - 1] + 1 == bounds[level]) {
+        buffer_appendf(out, "%d contribution%s", bounds[level], bounds[level] == 1 ? "" : "s");
+    } else {
+        buffer_appendf(out, "%d to %d contributions", bounds[level - 1] + 1, bounds[level]);
+    }
+}
+
+static void write_contribution_heatmap(MemoryBuffer *out, const ContributionList *contribs, const ContributionStats *stats) {
+    if (contribs->size == 0) return;
+    static const char *const ROW_LABELS[7] = {NULL, "Mon", NULL, "Wed", NULL, "Fri", NULL};
+    int first_day = contribs->start_day;
+    int last_day = first_day + (int)contribs->size - 1;
+    /* Day 0 (1970-01-01) was a Thursday; the grid ends on a Saturday. */
+    int grid_end = last_day + 6 - ((last_day % 7) + 11) % 7;
+    int blocks = (grid_end - first_day) / (7 * HEATMAP_WEEKS) + 1;
+    int width = HEATMAP_LEFT + HEATMAP_WEEKS * HEATMAP_CELL;
+    buffer_appendf(out, "<svg viewBox=\"0 0 %d %d\" role=\"img\" aria-label=\"Contribution calendar\">", width, blocks * HEATMAP_BLOCK_HEIGHT + 24);
+    for (int block = 0; block < blocks; ++block) {
+        int top = block * HEATMAP_BLOCK_HEIGHT;
+        int block_start = grid_end - (block + 1) * 7 * HEATMAP_WEEKS + 1;
+        int block_end = block_start + 7 * HEATMAP_WEEKS - 1;
+        char from[11];
+        char to[11];
+        format_iso_day(block_start > first_day ? block_start : first_day, from);
+        format_iso_day(block_end < last_day ? block_end : last_day, to);
+        buffer_appendf(out, "<text x=\"%d\" y=\"%d\">%s to %s</text>", HEATMAP_LEFT, top + 12, from, to);
+        for (int row = 0; row < 7; ++row) {
+            if (ROW_LABELS[row]) buffer_appendf(out, "<text x=\"0\" y=\"%d\">%s</text>", top + 29 + row * HEATMAP_CELL, ROW_LABELS[row]);
+        }
+        for (int level = 0; level < HEATMAP_LEVELS; ++level) {
+            int open = 0;
+            for (int row = 0; row < 7; ++row) {
+                int run = 0;
+                /* One step past the last week flushes the final run. */
+                for (int week = 0; week <= HEATMAP_WEEKS; ++week) {
+                    int day = block_start + week * 7 + row;
+                    if (week < HEATMAP_WEEKS && day >= first_day && day <= last_day && heatmap_level(stats, contribs->counts[day - first_day]) == level) {
+                        run++;
+                        continue;
+                    }
+                    if (run == 0) continue;
+                    if (!open) {
+                        buffer_appendf(out, "<path class=\"heatmap__level heatmap__level--%d\" d=\"", level);
+                        open = 1;
+                    }
+                    buffer_append(out, "M", 1);
+                    buffer_append_int(out, HEATMAP_LEFT + (week - run) * HEATMAP_CELL);
+                    buffer_append(out, ",", 1);
+                    buffer_append_int(out, top + 25 + row * HEATMAP_CELL);
+                    buffer_append(out, "h", 1);
+                    buffer_append_int(out, run * HEATMAP_CELL - 2);
+                    run = 0;
+                }
+            }
+            if (open) {
+                buffer_append_str(out, "\"><title>");
+                heatmap_level_title(out, stats, level);
+                buffer_append_str(out, "</title></path>");
+            }
+        }
+    }
+    int legend_top = blocks * HEATMAP_BLOCK_HEIGHT;
+    int legend_left = width - 32 - HEATMAP_LEVELS * HEATMAP_CELL;
+    buffer_appendf(out, "<text x=\"%d\" y=\"%d\" text-anchor=\"end\">Less</text>", legend_left - 4, legend_top + 14);
+    for (int level = 0; level < HEATMAP_LEVELS; ++level) {
+        buffer_appendf(out, "<path class=\"heatmap__level heatmap__level--%d\" d=\"M%d,%dh10\"/>", level, legend_left + level * HEATMAP_CELL, legend_top + 10);
+    }
+    buffer_appendf(out, "<text x=\"%d\" y=\"%d\">More</text></svg>", legend_left + HEATMAP_LEVELS * HEATMAP_CELL + 2, legend_top + 14);
+}
+
+/* Output of fields that change on every run without the data changing (the
+ * generation timestamp) is recorded so the page digest can skip it. */
+#define TEMPLATE_VOLATILE_SPANS 4
+
+/* With --cache-dir, each rendered {% block %} section is kept in
+ * <dir>/<page>.<section>, where <page> is a hash of the output path. The
+ * file starts with a hash of everything the section reads; when the next
+ * run computes the same hash, the cached bytes are copied into the page
+ * instead of rendering the section again. */
+typedef struct {
+    const char *dir;
+    uint64_t page;
+} SectionCache;
+
+typedef struct {
+    char magic[4];
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t size;
+} SectionHeader;
+
+static const char SECTION_MAGIC[4] = {'G', 'S', 'S', 'C'};
+
+#define TEMPLATE_SECTION_NAME(id, name, extra, json) name,
+static const char *SECTION_NAMES[] = {TEMPLATE_SECTIONS(TEMPLATE_SECTION_NAME)};
+
+typedef struct {
+    const Context *ctx;
+    const char *asset_prefix;
+    const ContributionStats *activity;
+    YearWindow windows[MAX_CONTRIBUTION_YEARS];
+    size_t window_count;
+    long long weekday_max;
+    size_t index[TEMPLATE_LIST_COUNT]; /* current item of each open loop */
+    size_t volatile_start[TEMPLATE_VOLATILE_SPANS];
+    size_t volatile_end[TEMPLATE_VOLATILE_SPANS];
+    size_t volatile_count;
+    int chartjs;               /* --chartjs: also emit the Chart.js loader */
+    const char *data_url;      /* --split-data: chart data file, else NULL */
+    const SectionCache *cache; /* NULL renders every section */
+    uint64_t section_key;      /* of the section being rendered */
+    size_t section_start;
+    size_t section_volatile;
+} TemplateState;
+
+typedef enum {
+    TEMPLATE_VALUE_TEXT,   /* text needs escaping */
+    TEMPLATE_VALUE_SAFE,   /* text was formatted here and is already safe */
+    TEMPLATE_VALUE_NUMBER
+} TemplateValueKind;
+
+typedef struct {
+    TemplateValueKind kind;
+    const char *text;
+    size_t length;
+    long long number;
+    char scratch[512];
+} TemplateValue;
+
+static const char *WEEKDAY_NAMES[7] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+
+static void template_value_text(TemplateValue *value, const char *text) {
+    value->kind = TEMPLATE_VALUE_TEXT;
+    value->text = text;
+    value->length = strlen(text);
+}
+
+static void template_value_number(TemplateValue *value, long long number) {
+    value->kind = TEMPLATE_VALUE_NUMBER;
+    value->number = number;
+}
+
+static void template_value_format(TemplateValue *value, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(value->scratch, sizeof(value->scratch), format, args);
+    va_end(args);
+    value->kind = TEMPLATE_VALUE_SAFE;
+    value->text = value->scratch;
+    value->length = written < 0 ? 0 : (size_t)written < sizeof(value->scratch) ? (size_t)written : sizeof(value->scratch) - 1;
+}
+
+static void template_value_fixed(TemplateValue *value, double number, int decimals) {
+    value->kind = TEMPLATE_VALUE_SAFE;
+    value->text = value->scratch;
+    value->length = format_fixed(number, decimals, value->scratch);
+}
+
+static void template_value_day(TemplateValue *value, int day) {
+    format_iso_day(day, value->scratch);
+    value->kind = TEMPLATE_VALUE_SAFE;
+    value->text = value->scratch;
+    value->length = 10;
+}
+
+static size_t template_list_size(const TemplateState *state, int list) {
+    const Context *ctx = state->ctx;
+    switch (list) {
+        case LIST_LANGUAGE_SUMMARY: return ctx->languages.size;
+        case LIST_CONTRIBUTION_TRAIL: return ctx->contributions.size - contribution_trail_start(&ctx->contributions);
+        case LIST_WEEKDAYS: return state->activity->active_days > 0 ? 7 : 0;
+        case LIST_MEMBERS: return ctx->members.size;
+        case LIST_YEAR_WINDOWS: return state->window_count;
+        case LIST_TOP_REPOS: return ctx->top_repos.size;
+        default: return 0;
+    }
+}
+
+/* Resolves one field against the context, reading list items at the
+ * current loop position. */
+static void template_resolve(const TemplateState *state, int field, TemplateValue *value) {
+    const Context *ctx = state->ctx;
+    const ContributionStats *activity = state->activity;
+    const LanguageEntry *entry = &ctx->languages.items[state->index[LIST_LANGUAGE_SUMMARY]];
+    const RepoEntry *repo = &ctx->top_repos.items[state->index[LIST_TOP_REPOS]];
+    const TeamMember *member = &ctx->members.items[state->index[LIST_MEMBERS]];
+    const YearWindow *window = &state->windows[state->index[LIST_YEAR_WINDOWS]];
+    size_t weekday = state->index[LIST_WEEKDAYS];
+    size_t last = activity->size ? activity->size - 1 : 0;
+
+    switch (field) {
+        case FIELD_ASSET_PREFIX: template_value_text(value, state->asset_prefix); break;
+        case FIELD_GENERATED_AT: template_value_text(value, ctx->generated_at); break;
+        case FIELD_IS_USER: template_value_number(value, ctx->kind == CONTEXT_USER); break;
+        case FIELD_IS_ORG: template_value_number(value, ctx->kind == CONTEXT_ORG); break;
+        case FIELD_IS_TEAM: template_value_number(value, ctx->kind == CONTEXT_TEAM); break;
+        case FIELD_PROFILE_NAME: template_value_text(value, ctx->name); break;
+        case FIELD_PROFILE_LOGIN: template_value_text(value, ctx->login); break;
+        case FIELD_PROFILE_AVATAR_URL: template_value_text(value, ctx->avatar_url); break;
+        case FIELD_PROFILE_BIO: template_value_text(value, ctx->bio); break;
+        case FIELD_PROFILE_LOCATION: template_value_text(value, ctx->location); break;
+        case FIELD_PROFILE_BLOG: template_value_text(value, ctx->blog); break;
+        case FIELD_STATS_TOTAL_STARS: template_value_number(value, ctx->total_stars); break;
+        case FIELD_STATS_TOTAL_FORKS: template_value_number(value, ctx->total_forks); break;
+        case FIELD_STATS_FOLLOWERS: template_value_number(value, ctx->followers); break;
+        case FIELD_STATS_FOLLOWING: template_value_number(value, ctx->following); break;
+        case FIELD_STATS_PUBLIC_REPOS: template_value_number(value, ctx->public_repos); break;
+        case FIELD_STATS_TOTAL_CONTRIBUTIONS: template_value_number(value, ctx->total_contributions); break;
+        case FIELD_ACTIVITY_DAYS: template_value_number(value, (long long)activity->size); break;
+        case FIELD_ACTIVITY_ACTIVE_DAYS: template_value_number(value, activity->active_days); break;
+        case FIELD_ACTIVITY_LONGEST_STREAK: template_value_number(value, activity->longest_streak); break;
+        case FIELD_ACTIVITY_CURRENT_STREAK: template_value_number(value, activity->current_streak); break;
+        case FIELD_ACTIVITY_AVERAGE_7: template_value_fixed(value, contribution_window_average(activity, last, 7), 1); break;
+        case FIELD_ACTIVITY_AVERAGE_30: template_value_fixed(value, contribution_window_average(activity, last, 30), 1); break;
+        case FIELD_ACTIVITY_BUSIEST_WEEKDAY: template_value_text(value, WEEKDAY_NAMES[contribution_busiest_weekday(activity)]); break;
+        case FIELD_ACTIVITY_BUSIEST_SHARE: {
+            long long busiest = activity->weekday_totals[contribution_busiest_weekday(activity)];
+            template_value_fixed(value, activity->total ? (double)busiest * 100.0 / (double)activity->total : 0.0, 0);
+            break;
+        }
+        case FIELD_ACTIVITY_P25: template_value_number(value, activity->p25); break;
+        case FIELD_ACTIVITY_P50: template_value_number(value, activity->p50); break;
+        case FIELD_ACTIVITY_P75: template_value_number(value, activity->p75); break;
+        case FIELD_ACTIVITY_P90: template_value_number(value, activity->p90); break;
+        case FIELD_ACTIVITY_P99: template_value_number(value, activity->p99); break;
+        case FIELD_ACTIVITY_BEST_DATE: template_value_day(value, activity->best_day); break;
+        case FIELD_ACTIVITY_BEST_COUNT: template_value_number(value, activity->best_count); break;
+        case FIELD_SPARKLINE_WEEKS: template_value_number(value, TEAM_SPARKLINE_WEEKS); break;
+        case FIELD_SPARKLINE_WIDTH: template_value_number(value, (TEAM_SPARKLINE_WEEKS - 1) * 4); break;
+        case FIELD_HISTORY: template_value_number(value, ctx->history.rows >= 2); break;
+        case FIELD_HISTORY_SINCE: template_value_day(value, ctx->history.rows ? ctx->history.days[0] : 0); break;
+        case FIELD_CHARTJS: template_value_number(value, state->chartjs); break;
+        case FIELD_DATA_URL: template_value_text(value, state->data_url ? state->data_url : ""); break;
+        case FIELD_STALE: template_value_number(value, (ctx->stale & STALE_ALL) != 0); break;
+        case FIELD_STALE_CONTRIBUTIONS: template_value_number(value, (ctx->stale & STALE_CONTRIBUTIONS) != 0); break;
+        case FIELD_ENTRY_LANGUAGE: template_value_text(value, entry->language); break;
+        case FIELD_ENTRY_SHARE: template_value_fixed(value, entry->share, 2); break;
+        case FIELD_ENTRY_BYTES: template_value_number(value, entry->bytes); break;
+        case FIELD_ENTRY_COLOR: template_value_text(value, CHART_PALETTE[state->index[LIST_LANGUAGE_SUMMARY] % CHART_PALETTE_SIZE]); break;
+        case FIELD_POINT_DATE: {
+            size_t day = contribution_trail_start(&ctx->contributions) + state->index[LIST_CONTRIBUTION_TRAIL];
+            template_value_day(value, ctx->contributions.start_day + (int)day);
+            break;
+        }
+        case FIELD_POINT_COUNT: {
+            size_t day = contribution_trail_start(&ctx->contributions) + state->index[LIST_CONTRIBUTION_TRAIL];
+            template_value_number(value, ctx->contributions.counts[day]);
+            break;
+        }
+        case FIELD_DAY_LABEL: template_value_format(value, "%.3s", WEEKDAY_NAMES[weekday]); break;
+        case FIELD_DAY_WIDTH: {
+            double width = state->weekday_max ? (double)activity->weekday_totals[weekday] * 100.0 / (double)state->weekday_max : 0.0;
+            template_value_fixed(value, width, 1);
+            break;
+        }
+        case FIELD_DAY_TOTAL: template_value_number(value, activity->weekday_totals[weekday]); break;
+        case FIELD_MEMBER_LOGIN: template_value_text(value, member->login); break;
+        case FIELD_MEMBER_SPARKLINE: {
+            int peak = 1;
+            for (size_t w = 0; w < TEAM_SPARKLINE_WEEKS; ++w) {
+                if (member->weeks[w] > peak) peak = member->weeks[w];
+            }
+            size_t used = 0;
+            /* A point takes at most a space, 21 digits, a comma and 32. */
+            for (size_t w = 0; w < TEAM_SPARKLINE_WEEKS && used + 55 <= sizeof(value->scratch); ++w) {
+                if (w) value->scratch[used++] = ' ';
+                used += format_int((long long)(w * 4), value->scratch + used);
+                value->scratch[used++] = ',';
+                used += format_fixed(23.0 - (double)member->weeks[w] * 22.0 / (double)peak, 1, value->scratch + used);
+            }
+            value->kind = TEMPLATE_VALUE_SAFE;
+            value->text = value->scratch;
+            value->length = used;
+            break;
+        }
+        case FIELD_MEMBER_TOTAL: template_value_number(value, member->total_contributions); break;
+        case FIELD_WINDOW_FROM: template_value_day(value, window->from_day); break;
+        case FIELD_WINDOW_TO: template_value_day(value, window->to_day); break;
+        case FIELD_WINDOW_TOTAL: template_value_number(value, window->total); break;
+        case FIELD_WINDOW_CHANGE: {
+            size_t i = state->index[LIST_YEAR_WINDOWS];
+            if (i + 1 < state->window_count && state->windows[i + 1].total > 0) {
+                double previous = (double)state->windows[i + 1].total;
+                template_value_format(value, "%+.1f%%", ((double)window->total - previous) * 100.0 / previous);
+            } else {
+                template_value_format(value, "");
+            }
+            break;
+        }
+        case FIELD_REPO_NAME: template_value_text(value, repo->name); break;
+        case FIELD_REPO_URL: template_value_text(value, repo->url); break;
+        case FIELD_REPO_DESCRIPTION: template_value_text(value, repo->description); break;
+        case FIELD_REPO_LANGUAGE: template_value_text(value, repo->language); break;
+        case FIELD_REPO_STARS: template_value_number(value, repo->stars); break;
+        case FIELD_REPO_FORKS: template_value_number(value, repo->forks); break;
+        case FIELD_REPO_UPDATED_ON:
+            template_value_text(value, repo->updated_at);
+            value->length = value->length >= 10 ? 10 : 0;
+            break;
+        default: template_value_text(value, ""); break;
+    }
+}
+
+static int template_truthy(const TemplateState *state, const TemplateOp *op) {
+    if (op->flags & TEMPLATE_LIST) {
+        return template_list_size(state, op->arg) > 0;
+    }
+    TemplateValue value;
+    template_resolve(state, op->arg, &value);
+    return value.kind == TEMPLATE_VALUE_NUMBER ? value.number != 0 : value.length > 0;
+}
+
+/* Fields that expand to generated markup rather than a single value.
+ * Returns 0 for every other field. */
+static int template_write_markup(const TemplateState *state, int field, MemoryBuffer *out) {
+    const Context *ctx = state->ctx;
+    switch (field) {
+        case FIELD_LANGUAGE_CHART:
+            write_language_svg(out, &ctx->languages);
+            return 1;
+        case FIELD_CONTRIBUTION_CHART:
+            write_contribution_svg(out, &ctx->contributions, state->activity);
+            return 1;
+        case FIELD_CONTRIBUTION_HEATMAP:
+            write_contribution_heatmap(out, &ctx->contributions, state->activity);
+            return 1;
+        case FIELD_HISTORY_CHART:
+            if (ctx->history.rows >= 2) write_history_svg(out, &ctx->history);
+            return 1;
+        case FIELD_LANGUAGE_DRIFT_CHART:
+            if (ctx->history.rows >= 2) write_language_drift_svg(out, &ctx->history);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void template_write_json(const TemplateState *state, const TemplateOp *op, MemoryBuffer *out) {
+    const Context *ctx = state->ctx;
+    int list = (op->flags & TEMPLATE_LIST) != 0;
+    if (list && op->arg == LIST_LANGUAGE_SUMMARY) {
+        write_language_json(out, &ctx->languages);
+    } else if (list && op->arg == LIST_CONTRIBUTION_TRAIL) {
+        write_contribution_json(out, &ctx->contributions);
+    } else if (!list && op->arg == FIELD_HISTORY && ctx->history.rows >= 2) {
+        write_history_json(out, &ctx->history);
+    } else {
+        buffer_append_str(out, "null");
+    }
+}
+
+static uint64_t hash_text(uint64_t hash, const char *text) {
+    return fnv1a64(hash, text, strlen(text) + 1);
+}
+
+static uint64_t hash_number(uint64_t hash, long long value) {
+    return fnv1a64(hash, &value, sizeof(value));
+}
+
+static uint64_t hash_contributions(uint64_t hash, const ContributionList *contribs) {
+    hash = hash_number(hash, contribs->start_day);
+    hash = hash_number(hash, (long long)contribs->size);
+    return fnv1a64(hash, contribs->counts, contribs->size * sizeof(*contribs->counts));
+}
+
+/* Hash of every input the section reads. Keep in step with the fields the
+ * section uses in templates/index.html.j2. */
+static uint64_t template_section_key(const TemplateState *state, int section) {
+    const Context *ctx = state->ctx;
+    uint64_t hash = hash_number(FNV_OFFSET_BASIS, (long long)TEMPLATE_DIGEST);
+    hash = hash_number(hash, (long long)RENDERER_DIGEST);
+    hash = hash_number(hash, section);
+    hash = hash_number(hash, ctx->kind);
+    hash = hash_text(hash, state->asset_prefix);
+    switch (section) {
+        case SECTION_HERO:
+            hash = hash_text(hash, ctx->login);
+            hash = hash_text(hash, ctx->name);
+            hash = hash_text(hash, ctx->avatar_url);
+            hash = hash_text(hash, ctx->bio);
+            hash = hash_text(hash, ctx->location);
+            hash = hash_text(hash, ctx->blog);
+            hash = hash_number(hash, (long long)ctx->members.size);
+            break;
+        case SECTION_STATS: {
+            const int totals[] = {ctx->total_stars, ctx->total_forks, ctx->followers, ctx->following, ctx->public_repos, ctx->total_contributions};
+            hash = fnv1a64(hash, totals, sizeof(totals));
+            hash = hash_number(hash, (long long)ctx->members.size);
+            hash = hash_contributions(hash, &ctx->contributions);
+            break;
+        }
+        case SECTION_LANGUAGES:
+            for (size_t i = 0; i < ctx->languages.size; ++i) {
+                const LanguageEntry *entry = &ctx->languages.items[i];
+                hash = hash_text(hash, entry->language);
+                hash = hash_number(hash, entry->bytes);
+                hash = fnv1a64(hash, &entry->share, sizeof(entry->share));
+            }
+            break;
+        case SECTION_ACTIVITY:
+            hash = hash_contributions(hash, &ctx->contributions);
+            hash = hash_number(hash, ctx->stale & STALE_CONTRIBUTIONS);
+            for (size_t i = 0; i < ctx->members.size; ++i) {
+                const TeamMember *member = &ctx->members.items[i];
+                hash = hash_text(hash, member->login);
+                hash = hash_number(hash, member->total_contributions);
+                hash = fnv1a64(hash, member->weeks, sizeof(member->weeks));
+            }
+            break;
+        case SECTION_REPOS:
+            for (size_t i = 0; i < ctx->top_repos.size; ++i) {
+                const RepoEntry *repo = &ctx->top_repos.items[i];
+                hash = hash_text(hash, repo->name);
+                hash = hash_text(hash, repo->url);
+                hash = hash_text(hash, repo->description);
+                hash = hash_text(hash, repo->language);
+                hash = hash_text(hash, repo->updated_at);
+                hash = hash_number(hash, repo->stars);
+                hash = hash_number(hash, repo->forks);
+            }
+            break;
+        default:
+            break;
+    }
+    return hash;
+}
+
+static void section_cache_path(const SectionCache *cache, int section, char *out, size_t size) {
+    snprintf(out, size, "%s/%016llx.%s", cache->dir, (unsigned long long)cache->page, SECTION_NAMES[section]);
+}
+
+/* Appends the cached section to out if its key matches. Returns 0 on a hit
+ * and -1 when the section has to be rendered. */
+static int section_cache_load(const SectionCache *cache, int section, uint64_t key, MemoryBuffer *out) {
+    char path[1100];
+    section_cache_path(cache, section, path, sizeof(path));
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return -1;
+    SectionHeader header;
+    int hit = fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, SECTION_MAGIC, 4) == 0 &&
+              header.key == key && header.size < ((uint64_t)1 << 30);
+    if (hit) {
+        size_t size = (size_t)header.size;
+        buffer_reserve(out, size);
+        hit = fread(out->data + out->size, 1, size, fp) == size;
+        if (hit) out->size += size;
+    }
+    fclose(fp);
+    return hit ? 0 : -1;
+}
+
+static void section_cache_store(const SectionCache *cache, int section, uint64_t key, const char *data, size_t size) {
+    SectionHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SECTION_MAGIC, 4);
+    header.key = key;
+    header.size = size;
+    MemoryBuffer record = {0};
+    buffer_reserve(&record, sizeof(header) + size);
+    buffer_append(&record, (const char *)&header, sizeof(header));
+    buffer_append(&record, data, size);
+    char path[1100];
+    section_cache_path(cache, section, path, sizeof(path));
+    /* A failed store only costs a render next time. */
+    write_file_atomic(path, record.data, record.size);
+    free(record.data);
+}
+
+/* Runs the op array produced by tools/template_compiler.c. Control flow is
+ * resolved to jump targets at build time, so this is a single forward scan
+ * with backward jumps only at {% endfor %}. */
+static void template_execute(const TemplateOp *ops, size_t count, const char *text, TemplateState *state, MemoryBuffer *out) {
+    size_t pc = 0;
+    while (pc < count) {
+        const TemplateOp *op = &ops[pc];
+        switch (op->op) {
+            case TEMPLATE_OP_TEXT:
+                buffer_append(out, text + op->offset, op->length);
+                pc++;
+                break;
+            case TEMPLATE_OP_FIELD: {
+                if (template_write_markup(state, op->arg, out)) {
+                    pc++;
+                    break;
+                }
+                TemplateValue value;
+                size_t start = out->size;
+                template_resolve(state, op->arg, &value);
+                if (value.kind == TEMPLATE_VALUE_NUMBER) {
+                    buffer_append_int(out, value.number);
+                } else if (value.kind == TEMPLATE_VALUE_TEXT && !(op->flags & TEMPLATE_SAFE)) {
+                    buffer_append_html_n(out, value.text, value.length);
+                } else {
+                    buffer_append(out, value.text, value.length);
+                }
+                if (op->arg == FIELD_GENERATED_AT && state->volatile_count < TEMPLATE_VOLATILE_SPANS) {
+                    state->volatile_start[state->volatile_count] = start;
+                    state->volatile_end[state->volatile_count++] = out->size;
+                }
+                pc++;
+                break;
+            }
+            case TEMPLATE_OP_LENGTH:
+                buffer_append_int(out, (long long)template_list_size(state, op->arg));
+                pc++;
+                break;
+            case TEMPLATE_OP_JSON:
+                template_write_json(state, op, out);
+                pc++;
+                break;
+            case TEMPLATE_OP_IF: {
+                int truthy = template_truthy(state, op);
+                if (op->flags & TEMPLATE_NEGATE) truthy = !truthy;
+                pc = truthy ? pc + 1 : op->offset;
+                break;
+            }
+            case TEMPLATE_OP_JUMP:
+                pc = op->offset;
+                break;
+            case TEMPLATE_OP_FOR:
+                if (template_list_size(state, op->arg) == 0) {
+                    pc = op->offset;
+                } else {
+                    state->index[op->arg] = 0;
+                    pc++;
+                }
+                break;
+            case TEMPLATE_OP_ENDFOR:
+                if (++state->index[op->arg] < template_list_size(state, op->arg)) {
+                    pc = op->offset;
+                } else {
+                    state->index[op->arg] = 0;
+                    pc++;
+                }
+                break;
+            case TEMPLATE_OP_BLOCK:
+                if (state->cache) {
+                    state->section_key = template_section_key(state, op->arg);
+                    if (section_cache_load(state->cache, op->arg, state->section_key, out) == 0) {
+                        pc = op->offset + 1;
+                        break;
+                    }
+                    state->section_start = out->size;
+                    state->section_volatile = state->volatile_count;
+                }
+                pc++;
+                break;
+            case TEMPLATE_OP_ENDBLOCK:
+                /* Sections holding the timestamp would defeat the digest. */
+                if (state->cache && state->volatile_count == state->section_volatile) {
+                    section_cache_store(state->cache, op->arg, state->section_key, out->data + state->section_start,
+                                        out->size - state->section_start);
+                }
+                pc++;
+                break;
+            default:
+                pc++;
+                break;
+        }
+    }
+}
+
+#define WRITE_FORCE 0x01          /* write even if the digest is unchanged */
+#define WRITE_KEEP_TIMESTAMP 0x02 /* ...and then reuse the recorded timestamp */
+#define WRITE_CHARTJS 0x04        /* load Chart.js over the inline SVG charts */
+#define WRITE_SPLIT_DATA 0x08     /* ...with its data in a separate file */
+
+/* Renders templates/index.html.j2 into out and returns a digest of
+ * everything but the timestamp. activity holds ctx's contribution stats.
+ * asset_prefix is prepended to relative asset links so pages written into
+ * per-user subdirectories still resolve docs/assets. cache and data_url may
+ * be NULL. */
+static uint64_t render_html(const Context *ctx, const ContributionStats *activity, const char *asset_prefix, const SectionCache *cache, int flags,
+                            const char *data_url, MemoryBuffer *out) {
+    TemplateState state;
+    memset(&state, 0, sizeof(state));
+    state.ctx = ctx;
+    state.activity = activity;
+    state.asset_prefix = asset_prefix;
+    state.chartjs = (flags & WRITE_CHARTJS) != 0;
+    state.data_url = data_url;
+    state.cache = cache;
+    for (int i = 0; i < 7; ++i) {
+        if (activity->weekday_totals[i] > state.weekday_max) state.weekday_max = activity->weekday_totals[i];
+    }
+    /* A single period has nothing to compare against. */
+    state.window_count = contribution_year_windows(&ctx->contributions, state.windows, MAX_CONTRIBUTION_YEARS);
+    if (state.window_count < 2) state.window_count = 0;
+
+    size_t begin = out->size;
+    template_execute(TEMPLATE_OPS, TEMPLATE_OP_COUNT, TEMPLATE_TEXT, &state, out);
+
+    uint64_t digest = FNV_OFFSET_BASIS;
+    size_t cursor = begin;
+    for (size_t i = 0; i < state.volatile_count; ++i) {
+        digest = fnv1a64(digest, out->data + cursor, state.volatile_start[i] - cursor);
+        cursor = state.volatile_end[i];
+    }
+    return fnv1a64(digest, out->data + cursor, out->size - cursor);
+}
+
+
+/* The chart data that --split-data moves out of the page. */
+static void write_page_data(MemoryBuffer *out, const Context *ctx) {
+    buffer_append_str(out, "{\"languages\":");
+    write_language_json(out, &ctx->languages);
+    buffer_append_str(out, ",\"contributions\":");
+    write_contribution_json(out, &ctx->contributions);
+    buffer_append_str(out, ",\"history\":");
+    if (ctx->history.rows >= 2) {
+        write_history_json(out, &ctx->history);
+    } else {
+        buffer_append_str(out, "null");
+    }
+    buffer_append_str(out, "}\n");
+}
+
+/* path with its file name replaced by name. */
+static void sibling_path(const char *path, const char *name, char *out, size_t size) {
+    const char *slash = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash > slash) slash = backslash;
+    int dir = slash ? (int)(slash - path + 1) : 0;
+    snprintf(out, size, "%.*s%s", dir, path, name);
+}
+
+/* Reads "<hex digest> <generated_at>" and, with --split-data, the data
+ * file name on a second line from a page's .digest file. */
+static int read_page_digest(const char *path, uint64_t *digest, char generated_at[32], char data_name[32]) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    char line[128];
+    char second[64];
+    int ok = fgets(line, sizeof(line), fp) != NULL;
+    if (!ok || !fgets(second, sizeof(second), fp)) second[0] = '\0';
+    fclose(fp);
+    if (!ok) return -1;
+    size_t name_length = strcspn(second, "\r\n");
+    if (name_length > 31) name_length = 0;
+    memcpy(data_name, second, name_length);
+    data_name[name_length] = '\0';
+    char *end = NULL;
+    unsigned long long value = strtoull(line, &end, 16);
+    if (end != line + 16 || *end != ' ') return -1;
+    *digest = (uint64_t)value;
+    size_t length = strcspn(end + 1, "\r\n");
+    if (length > 31) length = 31;
+    memcpy(generated_at, end + 1, length);
+    generated_at[length] = '\0';
+    return 0;
+}
+
+/* Pages are rendered in memory and published with one atomic rename, so a
+ * failed run never leaves a truncated index.html behind. The page digest is
+ * kept next to it in <page>.digest; when the data has not changed the page
+ * is left alone, so the timestamp alone never produces a new commit.
+ *
+ * With WRITE_SPLIT_DATA the chart data goes to data.<hash>.json beside the
+ * page, named by the same FNV-1a hash of its contents. The page names that
+ * file, so its digest still changes with the data, and the file is written
+ * before the page so the page never points at a missing file.
+ * Returns 0 when written, 1 when unchanged and -1 on error. */
+static int write_html(const Context *ctx, const ContributionStats *activity, const char *output_path, const char *asset_prefix, const char *cache_dir,
+                      int flags) {
+    char digest_path[1100];
+    snprintf(digest_path, sizeof(digest_path), "%s.digest", output_path);
+    uint64_t previous = 0;
+    char previous_time[32] = "";
+    char previous_data[32] = "";
+    int known = read_page_digest(digest_path, &previous, previous_time, previous_data) == 0 && file_exists(output_path);
+
+    char data_name[32] = "";
+    char data_path[1100];
+    if (flags & WRITE_SPLIT_DATA) {
+        MemoryBuffer data = {0};
+        write_page_data(&data, ctx);
+        snprintf(data_name, sizeof(data_name), "data.%016llx.json", (unsigned long long)fnv1a64(FNV_OFFSET_BASIS, data.data, data.size));
+        sibling_path(output_path, data_name, data_path, sizeof(data_path));
+        int status = file_exists(data_path) ? 0 : write_file_atomic(data_path, data.data, data.size);
+        free(data.data);
+        if (status != 0) return -1;
+    }
+    const char *data_url = data_name[0] ? data_name : NULL;
+
+    SectionCache cache = {cache_dir, fnv1a64(FNV_OFFSET_BASIS, output_path, strlen(output_path))};
+    const SectionCache *sections = cache_dir ? &cache : NULL;
+
+    MemoryBuffer page = {0};
+    buffer_reserve(&page, 64 * 1024);
+    uint64_t digest = render_html(ctx, activity, asset_prefix, sections, flags, data_url, &page);
+    int unchanged = known && digest == previous;
+    if (unchanged && !(flags & WRITE_FORCE)) {
+        free(page.data);
+        return 1;
+    }
+
+    const char *stamp = ctx->generated_at;
+    if (unchanged && (flags & WRITE_KEEP_TIMESTAMP) && previous_time[0]) {
+        Context stamped = *ctx;
+        snprintf(stamped.generated_at, sizeof(stamped.generated_at), "%s", previous_time);
+        page.size = 0;
+        render_html(&stamped, activity, asset_prefix, sections, flags, data_url, &page);
+        stamp = previous_time;
+    }
+
+    int status = write_file_atomic(output_path, page.data, page.size);
+    free(page.data);
+    if (status == 0) {
+        char record[96];
+        int length = snprintf(record, sizeof(record), "%016llx %s\n%s%s", (unsigned long long)digest, stamp, data_name, data_name[0] ? "\n" : "");
+        status = write_file_atomic(digest_path, record, (size_t)length);
+    }
+    /* Only the published page referred to the old data file. */
+    if (status == 0 && previous_data[0] && strcmp(previous_data, data_name) != 0 && strncmp(previous_data, "data.", 5) == 0) {
+        sibling_path(output_path, previous_data, data_path, sizeof(data_path));
+        remove(data_path);
+    }
+    return status;
+}
+
+/* ----------------------------- Precompression --------------------------- */
+
+/* --precompress writes <file>.gz, .br and .zst (whichever encoders were
+ * found at build time) next to each page and the stylesheet, so a static
+ * server can send them without compressing per request. Maximum levels are
+ * slow, so encoding runs on its own thread while pages keep rendering. */
+typedef int (*EncodeFn)(const unsigned char *data, size_t size, MemoryBuffer *out);
+
+typedef struct {
+    const char *suffix;
+    const char *coding; /* its HTTP Content-Encoding token */
+    EncodeFn encode;
+} Encoder;
+
+#ifdef HAVE_ZLIB
+static int encode_gzip(const unsigned char *data, size_t size, MemoryBuffer *out) {
+    if (size > ((size_t)1 << 30)) return -1;
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    /* 16 + MAX_WBITS selects the gzip wrapper. Its timestamp is left at
+     * zero, so the same page always compresses to the same bytes. */
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+    uLong bound = deflateBound(&stream, (uLong)size);
+    buffer_reserve(out, bound);
+    stream.next_in = (Bytef *)data;
+    stream.avail_in = (uInt)size;
+    stream.next_out = (Bytef *)out->data + out->size;
+    stream.avail_out = (uInt)bound;
+    int status = deflate(&stream, Z_FINISH);
+    out->size += stream.total_out;
+    deflateEnd(&stream);
+    return status == Z_STREAM_END ? 0 : -1;
+}
+#endif
+
+#ifdef HAVE_BROTLI
+static int encode_brotli(const unsigned char *data, size_t size, MemoryBuffer *out) {
+    size_t length = BrotliEncoderMaxCompressedSize(size);
+    if (length == 0) return -1;
+    buffer_reserve(out, length);
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_MAX_WINDOW_BITS, BROTLI_MODE_TEXT, size, data, &length,
+                               (uint8_t *)out->data + out->size)) {
+        return -1;
+    }
+    out->size += length;
+    return 0;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static int encode_zstd(const unsigned char *data, size_t size, MemoryBuffer *out) {
+    size_t bound = ZSTD_compressBound(size);
+    buffer_reserve(out, bound);
+    size_t length = ZSTD_compress(out->data + out->size, bound, data, size, ZSTD_maxCLevel());
+    if (ZSTD_isError(length)) return -1;
+    out->size += length;
+    return 0;
+}
+#endif
+
+static const Encoder ENCODERS[] = {
+#ifdef HAVE_ZLIB
+    {".gz", "gzip", encode_gzip},
+#endif
+#ifdef HAVE_BROTLI
+    {".br", "br", encode_brotli},
+#endif
+#ifdef HAVE_ZSTD
+    {".zst", "zstd", encode_zstd},
+#endif
+    {NULL, NULL, NULL}
+};
+
+/* An artifact at least as new as its source was made from it. */
+static int artifact_current(const char *source, const char *artifact) {
+    struct stat from;
+    struct stat to;
+    return stat(source, &from) == 0 && stat(artifact, &to) == 0 && to.st_mtime >= from.st_mtime;
+}
+
+/* Writes every missing or stale artifact for path, or all of them when the
+ * file was just rewritten; returns how many. */
+static size_t precompress_file(const char *path, int rewritten) {
+    FileView view;
+    int opened = 0;
+    size_t written = 0;
+    for (const Encoder *encoder = ENCODERS; encoder->suffix; ++encoder) {
+        char target[1100];
+        snprintf(target, sizeof(target), "%s%s", path, encoder->suffix);
+        if (!rewritten && artifact_current(path, target)) continue;
+        if (!opened) {
+            if (file_view_open(path, &view) != 0) {
+                fprintf(stderr, "Cannot read %s for compression\n", path);
+                return written;
+            }
+            opened = 1;
+        }
+        MemoryBuffer packed = {0};
+        if (encoder->encode(view.data, view.size, &packed) == 0 && write_file_atomic(target, packed.data, packed.size) == 0) {
+            written++;
+        } else {
+            fprintf(stderr, "Failed to write %s\n", target);
+        }
+        free(packed.data);
+    }
+    if (opened) file_view_close(&view);
+    return written;
+}
+
+typedef struct {
+    char *path;
+    int rewritten;
+} CompressJob;
+
+typedef struct {
+    CompressJob *jobs;
+    size_t size;
+    size_t capacity;
+    size_t next;
+    int closed;
+    size_t written;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_t thread;
+} Compressor;
+
+static void *compressor_main(void *arg) {
+    Compressor *compressor = (Compressor *)arg;
+    pthread_mutex_lock(&compressor->lock);
+    for (;;) {
+        while (compressor->next == compressor->size && !compressor->closed) {
+            pthread_cond_wait(&compressor->ready, &compressor->lock);
+        }
+        if (compressor->next == compressor->size) break;
+        CompressJob job = compressor->jobs[compressor->next++];
+        pthread_mutex_unlock(&compressor->lock);
+
+        size_t written = precompress_file(job.path, job.rewritten);
+        free(job.path);
+
+        pthread_mutex_lock(&compressor->lock);
+        compressor->written += written;
+    }
+    pthread_mutex_unlock(&compressor->lock);
+    return NULL;
+}
+
+static int compressor_start(Compressor *compressor) {
+    memset(compressor, 0, sizeof(*compressor));
+    pthread_mutex_init(&compressor->lock, NULL);
+    pthread_cond_init(&compressor->ready, NULL);
+    if (pthread_create(&compressor->thread, NULL, compressor_main, compressor) != 0) {
+        fprintf(stderr, "Failed to start the compression thread\n");
+        pthread_cond_destroy(&compressor->ready);
+        pthread_mutex_destroy(&compressor->lock);
+        return -1;
+    }
+    return 0;
+}
+
+/* Queues path for compression. rewritten is set when this run wrote the
+ * file; otherwise only missing or older artifacts are made. compressor is
+ * NULL without --precompress. */
+static void compressor_push(Compressor *compressor, const char *path, int rewritten) {
+    if (!compressor) return;
+    pthread_mutex_lock(&compressor->lock);
+    if (compressor->size == compressor->capacity) {
+        size_t capacity = compressor->capacity ? compressor->capacity * 2 : 16;
+        CompressJob *jobs = (CompressJob *)realloc(compressor->jobs, capacity * sizeof(CompressJob));
+        if (!jobs) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        compressor->jobs = jobs;
+        compressor->capacity = capacity;
+    }
+    compressor->jobs[compressor->size].path = _strdup(path);
+    compressor->jobs[compressor->size++].rewritten = rewritten;
+    pthread_cond_signal(&compressor->ready);
+    pthread_mutex_unlock(&compressor->lock);
+}
+
+/* Drains the queue and stops the thread. */
+static void compressor_finish(Compressor *compressor) {
+    pthread_mutex_lock(&compressor->lock);
+    compressor->closed = 1;
+    pthread_cond_signal(&compressor->ready);
+    pthread_mutex_unlock(&compressor->lock);
+    pthread_join(compressor->thread, NULL);
+    printf("Precompressed %zu file%s\n", compressor->written, compressor->written == 1 ? "" : "s");
+    free(compressor->jobs);
+    pthread_cond_destroy(&compressor->ready);
+    pthread_mutex_destroy(&compressor->lock);
+}
+
+/* The shared stylesheet under <output-dir>/assets, when there is one. */
+static void compressor_push_stylesheet(Compressor *compressor, const char *output_dir) {
+    char path[1100];
+    snprintf(path, sizeof(path), "%s/assets/styles.css", output_dir);
+    if (file_exists(path)) {
+        compressor_push(compressor, path, 0);
+    }
+}
+
+/* ---------------------------- Secondary outputs ------------------------- */
+
+/* Besides the page, every Context is rendered into a JSON API, a Markdown
+ * card for profile READMEs and a few badges, so other consumers need
+ * neither their own fetch nor an HTML scraper. The caller computes the
+ * stats once per Context and hands them to the page and to all of these. */
+typedef void (*RenderFn)(const Context *ctx, const ContributionStats *activity, MemoryBuffer *out);
+
+typedef struct {
+    const char *name; /* relative to the page's directory */
+    RenderFn render;
+    int personal;     /* built from the contribution calendar, which organizations lack */
+} Renderer;
+
+static const char *CONTEXT_KINDS[] = {"user", "org", "team"};
+
+static void json_field(MemoryBuffer *out, const char *name, long long value) {
+    buffer_append(out, ",", 1);
+    buffer_append_json_string(out, name);
+    buffer_append(out, ":", 1);
+    buffer_append_int(out, value);
+}
+
+static void json_text_field(MemoryBuffer *out, const char *name, const char *value) {
+    buffer_append(out, ",", 1);
+    buffer_append_json_string(out, name);
+    buffer_append(out, ":", 1);
+    if (value) {
+        buffer_append_json_string(out, value);
+    } else {
+        buffer_append_str(out, "null");
+    }
+}
+
+/* The last calendar day, which dates everything else in the file. No run
+ * timestamp is included so an unchanged file is not rewritten. */
+static void write_stats_json(const Context *ctx, const ContributionStats *activity, MemoryBuffer *out) {
+    char day[11];
+    buffer_append_str(out, "{\"login\":");
+    buffer_append_json_string(out, ctx->login);
+    json_text_field(out, "name", ctx->name);
+    json_text_field(out, "kind", CONTEXT_KINDS[ctx->kind]);
+    if (ctx->contributions.size > 0) {
+        format_iso_day(ctx->contributions.start_day + (int)ctx->contributions.size - 1, day);
+        json_text_field(out, "as_of", day);
+    } else {
+        json_text_field(out, "as_of", NULL);
+    }
+    json_field(out, "followers", ctx->followers);
+    json_field(out, "following", ctx->following);
+    json_field(out, "public_repos", ctx->public_repos);
+    json_field(out, "stars", ctx->total_stars);
+    json_field(out, "forks", ctx->total_forks);
+    json_field(out, "contributions", ctx->total_contributions);
+
+    buffer_append_str(out, ",\"activity\":{\"days\":");
+    buffer_append_int(out, (long long)activity->size);
+    json_field(out, "active_days", activity->active_days);
+    json_field(out, "current_streak", activity->current_streak);
+    json_field(out, "longest_streak", activity->longest_streak);
+    if (activity->size > 0) {
+        buffer_append_str(out, ",\"average_7\":");
+        buffer_append_fixed(out, contribution_window_average(activity, activity->size - 1, 7), 2);
+        buffer_append_str(out, ",\"average_30\":");
+        buffer_append_fixed(out, contribution_window_average(activity, activity->size - 1, 30), 2);
+    }
+    json_field(out, "p50", activity->p50);
+    json_field(out, "p90", activity->p90);
+    json_field(out, "p99", activity->p99);
+    if (activity->best_count > 0) {
+        format_iso_day(activity->best_day, day);
+        buffer_append_str(out, ",\"best_day\":{\"date\":");
+        buffer_append_json_string(out, day);
+        json_field(out, "count", activity->best_count);
+        buffer_append(out, "}", 1);
+    }
+    buffer_append(out, "}", 1);
+
+    buffer_append_str(out, ",\"languages\":[");
+    for (size_t i = 0; i < ctx->languages.size; ++i) {
+        const LanguageEntry *entry = &ctx->languages.items[i];
+        buffer_append_str(out, i ? ",{\"language\":" : "{\"language\":");
+        buffer_append_json_string(out, entry->language);
+        json_field(out, "bytes", entry->bytes);
+        buffer_append_str(out, ",\"share\":");
+        buffer_append_fixed(out, entry->share, 2);
+        buffer_append(out, "}", 1);
+    }
+    buffer_append_str(out, "],\"top_repos\":[");
+    for (size_t i = 0; i < ctx->top_repos.size; ++i) {
+        const RepoEntry *repo = &ctx->top_repos.items[i];
+        buffer_append_str(out, i ? ",{\"name\":" : "{\"name\":");
+        buffer_append_json_string(out, repo->name);
+        json_text_field(out, "url", repo->url);
+        json_text_field(out, "description", repo->description);
+        json_text_field(out, "language", repo->language);
+        json_text_field(out, "updated_at", repo->updated_at);
+        json_field(out, "stars", repo->stars);
+        json_field(out, "forks", repo->forks);
+        buffer_append(out, "}", 1);
+    }
+    buffer_append(out, "]", 1);
+    if (ctx->kind == CONTEXT_TEAM) {
+        buffer_append_str(out, ",\"members\":[");
+        for (size_t i = 0; i < ctx->members.size; ++i) {
+            buffer_append_str(out, i ? ",{\"login\":" : "{\"login\":");
+            buffer_append_json_string(out, ctx->members.items[i].login);
+            json_field(out, "contributions", ctx->members.items[i].total_contributions);
+            buffer_append(out, "}", 1);
+        }
+        buffer_append(out, "]", 1);
+    }
+
+    buffer_append_str(out, ",\"contribution_calendar\":{\"start\":");
+    if (ctx->contributions.size > 0) {
+        format_iso_day(ctx->contributions.start_day, day);
+        buffer_append_json_string(out, day);
+    } else {
+        buffer_append_str(out, "null");
+    }
+    buffer_append_str(out, ",\"counts\":[");
+    for (size_t i = 0; i < ctx->contributions.size; ++i) {
+        if (i) buffer_append(out, ",", 1);
+        buffer_append_int(out, ctx->contributions.counts[i]);
+    }
+    buffer_append_str(out, "]}}\n");
+}
+
+/* Backslash-escapes the characters Markdown would treat as formatting. */
+static void buffer_append_markdown(MemoryBuffer *out, const char *text) {
+    for (const char *p = text; *p; ++p) {
+        if (strchr("\\`*_[]<>|#", *p)) buffer_append(out, "\\", 1);
+        buffer_append(out, p, 1);
+    }
+}
+
+static void write_card_markdown(const Context *ctx, const ContributionStats *activity, MemoryBuffer *out) {
+    const char *name = ctx->name && ctx->name[0] ? ctx->name : ctx->login;
+    /* Teams are not GitHub accounts, so they get no profile link. */
+    buffer_append_str(out, ctx->kind == CONTEXT_TEAM ? "### " : "### [");
+    buffer_append_markdown(out, name);
+    if (ctx->kind == CONTEXT_TEAM) {
+        buffer_append_str(out, "\n\n");
+    } else {
+        buffer_appendf(out, "](https://github.com/%s)\n\n", ctx->login);
+    }
+    if (ctx->kind == CONTEXT_ORG) {
+        buffer_append_str(out, "| Stars | Forks | Repositories |\n| ---: | ---: | ---: |\n");
+        buffer_appendf(out, "| %d | %d | %d |\n", ctx->total_stars, ctx->total_forks, ctx->public_repos);
+    } else {
+        buffer_append_str(out, "| Stars | Followers | Contributions | Current streak | Longest streak |\n| ---: | ---: | ---: | ---: | ---: |\n");
+        buffer_appendf(out, "| %d | %d | %d | %d days | %d days |\n", ctx->total_stars, ctx->followers, ctx->total_contributions, activity->current_streak,
+                       activity->longest_streak);
+    }
+    if (ctx->languages.size > 0) {
+        buffer_append_str(out, "\n**Top languages:** ");
+        for (size_t i = 0; i < ctx->languages.size && i < 5; ++i) {
+            if (i) buffer_append_str(out, " · ");
+            buffer_append_markdown(out, ctx->languages.items[i].language);
+            buffer_append(out, " ", 1);
+            buffer_append_fixed(out, ctx->languages.items[i].share, 1);
+            buffer_append(out, "%", 1);
+        }
+        buffer_append(out, "\n", 1);
+    }
+    if (ctx->top_repos.size > 0) {
+        buffer_append_str(out, "\n**Top repositories:**\n\n");
+        for (size_t i = 0; i < ctx->top_repos.size; ++i) {
+            const RepoEntry *repo = &ctx->top_repos.items[i];
+            buffer_append_str(out, "- [");
+            buffer_append_markdown(out, repo->name);
+            buffer_appendf(out, "](%s) ★ %d", repo->url, repo->stars);
+            if (repo->description && repo->description[0]) {
+                buffer_append_str(out, " — ");
+                buffer_append_markdown(out, repo->description);
+            }
+            buffer_append(out, "\n", 1);
+        }
+    }
+}
+
+/* Flat badges in the familiar two-part layout. Widths come from a rough
+ * 7px-per-character estimate for 11px Verdana. */
+static void write_badge(MemoryBuffer *out, const char *label, const char *value, const char *color) {
+    int label_width = 10 + 7 * (int)strlen(label);
+    int value_width = 10 + 7 * (int)strlen(value);
+    int width = label_width + value_width;
+    buffer_appendf(out,
+                   "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"20\" role=\"img\" aria-label=\"%s: %s\"><title>%s: %s</title>"
+                   "<linearGradient id=\"s\" x2=\"0\" y2=\"100%%\"><stop offset=\"0\" stop-color=\"#bbb\" stop-opacity=\".1\"/><stop offset=\"1\" stop-opacity=\".1\"/></linearGradient>"
+                   "<clipPath id=\"r\"><rect width=\"%d\" height=\"20\" rx=\"3\" fill=\"#fff\"/></clipPath>"
+                   "<g clip-path=\"url(#r)\"><rect width=\"%d\" height=\"20\" fill=\"#555\"/><rect x=\"%d\" width=\"%d\" height=\"20\" fill=\"%s\"/><rect width=\"%d\" height=\"20\" fill=\"url(#s)\"/></g>"
+                   "<g fill=\"#fff\" text-anchor=\"middle\" font-family=\"Verdana,Geneva,DejaVu Sans,sans-serif\" font-size=\"11\">"
+                   "<text x=\"%d\" y=\"14\">%s</text><text x=\"%d\" y=\"14\">%s</text></g></svg>\n",
+                   width, label, value, label, value, width, label_width, label_width, value_width, color, width, label_width / 2, label, label_width + value_width / 2,
+                   value);
+}
+
+/* 1234 -> "1.2k", as badges usually abbreviate. */
+static void format_badge_count(long long count, char out[32]) {
+    size_t length;
+    if (count < 1000) {
+        length = format_int(count, out);
+    } else {
+        int millions = count >= 1000000;
+        length = format_fixed((double)count / (millions ? 1e6 : 1e3), 1, out);
+        if (length > 2 && out[length - 1] == '0' && out[length - 2] == '.') length -= 2;
+        out[length++] = millions ? 'M' : 'k';
+    }
+    out[length] = '\0';
+}
+
+static void write_stars_badge(const Context *ctx, const ContributionStats *activity, MemoryBuffer *out) {
+    (void)activity;
+    char value[32];
+    format_badge_count(ctx->total_stars, value);
+    write_badge(out, "stars", value, CHART_PALETTE[3]);
+}
+
+static void write_followers_badge(const Context *ctx, const ContributionStats *activity, MemoryBuffer *out) {
+    (void)activity;
+    char value[32];
+    format_badge_count(ctx->followers, value);
+    write_badge(out, "followers", value, CHART_PALETTE[0]);
+}
+
+static void write_contributions_badge(const Context *ctx, const ContributionStats *activity, MemoryBuffer *out) {
+    (void)activity;
+    char value[32];
+    format_badge_count(ctx->total_contributions, value);
+    write_badge(out, "contributions", value, "#26a641");
+}
+
+static void write_streak_badge(const Context *ctx, const ContributionStats *activity, MemoryBuffer *out) {
+    (void)ctx;
+    char value[32];
+    snprintf(value, sizeof(value), "%d day%s", activity->current_streak, activity->current_streak == 1 ? "" : "s");
+    write_badge(out, "streak", value, activity->current_streak > 0 ? CHART_PALETTE[4] : "#9f9f9f");
+}
+
+static const Renderer RENDERERS[] = {
+    {"api/stats.json", write_stats_json, 0},
+    {"card.md", write_card_markdown, 0},
+    {"badges/stars.svg", write_stars_badge, 0},
+    {"badges/followers.svg", write_followers_badge, 1},
+    {"badges/contributions.svg", write_contributions_badge, 1},
+    {"badges/streak.svg", write_streak_badge, 1},
+    {NULL, NULL, 0}
+};
+
+/* Returns 1 when path already holds exactly these bytes. */
+static int file_matches(const char *path, const char *data, size_t size) {
+    FileView view;
+    if (file_view_open(path, &view) != 0) return 0;
+    int same = view.size == size && memcmp(view.data, data, size) == 0;
+    file_view_close(&view);
+    return same;
+}
+
+/* Renders every secondary output for ctx into dir. Files whose content is
+ * unchanged are left alone, like the page. Returns how many were written,
+ * or -1 on error. */
+static int write_outputs(const Context *ctx, const ContributionStats *activity, const char *dir, Compressor *compressor) {
+    MemoryBuffer out = {0};
+    int written = 0;
+    for (const Renderer *renderer = RENDERERS; renderer->name; ++renderer) {
+        if (renderer->personal && ctx->kind == CONTEXT_ORG) continue;
+        char path[1100];
+        snprintf(path, sizeof(path), "%s/%s", dir, renderer->name);
+        out.size = 0;
+        renderer->render(ctx, activity, &out);
+        int fresh = !file_matches(path, out.data, out.size);
+        if (fresh) {
+            const char *slash = strrchr(renderer->name, '/');
+            char parent[1100];
+            snprintf(parent, sizeof(parent), "%s/%.*s", dir, slash ? (int)(slash - renderer->name) : 0, renderer->name);
+            if (ensure_directory(parent) != 0 || write_file_atomic(path, out.data, out.size) != 0) {
+                written = -1;
+                break;
+            }
+            written++;
+        }
+        compressor_push(compressor, path, fresh);
+    }
+    free(out.data);
+    return written;
+}
+
+/* ------------------------------- Batch mode ----------------------------- */
+
+typedef struct {
+    char **items;
+    int *intervals; /* --daemon seconds per login, 0 for --refresh */
+    size_t size;
+    size_t capacity;
+} LoginList;
+
+typedef struct {
+    const char *batch_path;
+    const char *org;
+    const char *team;
+    const char *output_dir;
+    const char *save_snapshot;
+    const char *from_snapshot;
+    const char *cache_dir;
+    int history;
+    int years;
+    int jobs;
+    int batch_size;
+    int write_flags;
+    int precompress;
+    int outputs;
+    const char *serve; /* --serve address, NULL to write files */
+    int daemon;        /* --daemon: keep running and rewrite on a schedule */
+    int webhook;       /* --webhook: --serve also applies signed webhooks */
+    int refresh;       /* --serve / --daemon refresh interval in seconds */
+    long long deadline; /* --deadline as a monotonic_ms() time, 0 for none */
+} Options;
+
+/* Shortest refresh interval accepted, so a typo cannot hammer the API. */
+#define MIN_REFRESH_SECONDS 10
+
+static void login_list_push(LoginList *list, const char *login, int interval) {
+    if (list->size == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->items = (char **)realloc(list->items, list->capacity * sizeof(char *));
+        list->intervals = (int *)realloc(list->intervals, list->capacity * sizeof(int));
+        if (!list->items || !list->intervals) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    list->intervals[list->size] = interval;
+    list->items[list->size++] = _strdup(login);
+}
+
+static void login_list_free(LoginList *list) {
+    for (size_t i = 0; i < list->size; ++i) {
+        free(list->items[i]);
+    }
+    free(list->items);
+    free(list->intervals);
+    list->items = NULL;
+    list->intervals = NULL;
+    list->size = 0;
+    list->capacity = 0;
+}
+
+/* Reads one login per line from path ("-" for stdin), optionally followed
+ * by the refresh interval in seconds --daemon uses for it. Blank lines and
+ * lines starting with '#' are ignored. */
+static int read_login_list(const char *path, LoginList *list) {
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    int status = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        char *start = line;
+        while (isspace((unsigned char)*start)) start++;
+        char *end = start + strlen(start);
+        while (end > start && isspace((unsigned char)end[-1])) end--;
+        *end = '\0';
+        if (*start == '\0' || *start == '#') continue;
+        int interval = 0;
+        char *gap = start + strcspn(start, " \t");
+        if (*gap) {
+            *gap++ = '\0';
+            char *rest = NULL;
+            long seconds = strtol(gap, &rest, 10);
+            if (rest == gap || *rest != '\0' || seconds < MIN_REFRESH_SECONDS || seconds > INT_MAX) {
+                fprintf(stderr, "Skipping '%s': the interval must be a number of seconds, at least %d\n", start, MIN_REFRESH_SECONDS);
+                status = -1;
+                continue;
+            }
+            interval = (int)seconds;
+        }
+        if (!is_valid_login(start)) {
+            fprintf(stderr, "Skipping invalid login '%s'\n", start);
+            status = -1;
+            continue;
+        }
+        login_list_push(list, start, interval);
+    }
+
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return status;
+}
+
+/* Aggregate dashboard for --team. Workers merge each member into ctx as
+ * soon as that member is rendered, so no per-member context is kept. */
+typedef struct {
+    Context ctx;
+    pthread_mutex_t lock;
+} Team;
+
+typedef struct {
+    const LoginList *logins;
+    const Options *options;
+    Team *team;
+    Compressor *compressor; /* NULL without --precompress */
+    pthread_mutex_t lock;
+    size_t succeeded;
+} BatchState;
+
+static void team_init(Team *team, const char *name) {
+    context_init(&team->ctx);
+    team->ctx.kind = CONTEXT_TEAM;
+    team->ctx.login = _strdup(name);
+    team->ctx.name = _strdup(name);
+    team->ctx.avatar_url = _strdup("");
+    team->ctx.bio = _strdup("");
+    team->ctx.location = _strdup("");
+    team->ctx.blog = _strdup("");
+    pthread_mutex_init(&team->lock, NULL);
+}
+
+static void team_free(Team *team) {
+    free_context(&team->ctx);
+    pthread_mutex_destroy(&team->lock);
+}
+
+static void team_add_member(Team *team, const Context *member) {
+    TeamMember entry;
+    entry.login = _strdup(member->login);
+    entry.total_contributions = member->total_contributions;
+    contribution_weekly_totals(&member->contributions, entry.weeks, TEAM_SPARKLINE_WEEKS);
+
+    pthread_mutex_lock(&team->lock);
+    Context *ctx = &team->ctx;
+    ctx->followers += member->followers;
+    ctx->public_repos += member->public_repos;
+    ctx->total_stars += member->total_stars;
+    ctx->total_forks += member->total_forks;
+    ctx->total_contributions += member->total_contributions;
+    ctx->stale |= member->stale;
+    for (size_t i = 0; i < member->top_repos.size; ++i) {
+        repo_top_insert(&ctx->top_repos, &member->top_repos.items[i], TOP_REPO_LIMIT);
+    }
+    for (size_t i = 0; i < member->languages.size; ++i) {
+        language_list_add(&ctx->languages, member->languages.items[i].language, member->languages.items[i].bytes);
+    }
+    contribution_list_add(&ctx->contributions, &member->contributions);
+    team_member_push(&ctx->members, entry);
+    pthread_mutex_unlock(&team->lock);
+}
+
+static int compare_team_members(const void *lhs, const void *rhs) {
+    const TeamMember *a = (const TeamMember *)lhs;
+    const TeamMember *b = (const TeamMember *)rhs;
+    if (b->total_contributions != a->total_contributions) {
+        return b->total_contributions - a->total_contributions;
+    }
+    return strcmp(a->login, b->login);
+}
+
+/* Loads the history store in dir into ctx, first appending ctx's totals
+ * when the data is freshly fetched. */
+static void context_attach_history(Context *ctx, const char *dir, int append) {
+    char path[1100];
+    snprintf(path, sizeof(path), "%s/history.bin", dir);
+    if (append) {
+        history_append(path, ctx);
+    } else {
+        history_load(path, &ctx->history, NULL);
+    }
+}
+
+static int render_user_page(Context *ctx, const Options *options, int fresh, Compressor *compressor) {
+    char dir[1024];
+    char path[1100];
+    snprintf(dir, sizeof(dir), "%s/%s", options->output_dir, ctx->login);
+    snprintf(path, sizeof(path), "%s/index.html", dir);
+    if (ensure_directory(dir) != 0) {
+        return -1;
+    }
+    if (options->history) {
+        context_attach_history(ctx, dir, fresh);
+    }
+    ContributionStats activity;
+    compute_contribution_stats(&ctx->contributions, &activity);
+    int status = write_html(ctx, &activity, path, "../", options->cache_dir, options->write_flags);
+    if (status >= 0) {
+        compressor_push(compressor, path, status == 0);
+        printf(status == 0 ? "Site updated for %s -> %s\n" : "No changes for %s (%s)\n", ctx->login, path);
+        if (options->outputs && write_outputs(ctx, &activity, dir, compressor) < 0) {
+            status = -1;
+        }
+    }
+    contribution_stats_free(&activity);
+    return status >= 0 ? 0 : -1;
+}
+
+/* In batch mode snapshot options name a directory holding <login>.snap. */
+static void batch_snapshot_path(const char *dir, const char *login, char *out, size_t size) {
+    snprintf(out, size, "%s/%s.snap", dir, login);
+}
+
+static void batch_finish_context(BatchState *state, Context *ctx, const char *login, int fresh, size_t *rendered) {
+    /* The API canonicalises login case; keep the requested spelling for paths. */
+    free(ctx->login);
+    ctx->login = _strdup(login);
+    if (state->options->save_snapshot && !(ctx->stale & STALE_ALL)) {
+        char path[1100];
+        batch_snapshot_path(state->options->save_snapshot, login, path, sizeof(path));
+        if (fresh) {
+            context_backfill_contributions(ctx, path);
+        }
+        write_snapshot(ctx, path);
+    }
+    if (render_user_page(ctx, state->options, fresh, state->compressor) == 0) {
+        *rendered += 1;
+    }
+    if (state->team) {
+        team_add_member(state->team, ctx);
+    }
+    free_context(ctx);
+}
+
+/* Renders a user whose fetch failed from their last snapshot under
+ * --deadline; without one the user is reported and skipped. */
+static void batch_fall_back(BatchState *state, const char *login, size_t *rendered) {
+    const Options *options = state->options;
+    if (options->deadline && options->save_snapshot) {
+        char path[1100];
+        Context ctx;
+        batch_snapshot_path(options->save_snapshot, login, path, sizeof(path));
+        if (load_stale_context(path, &ctx) == 0) {
+            batch_finish_context(state, &ctx, login, 0, rendered);
+            return;
+        }
+    }
+    fprintf(stderr, "Failed to fetch data for %s\n", login);
+}
+
+/* ---------------------------- Batch pipeline ---------------------------- */
+
+/* A --batch run is a pipeline. The calling thread is the network stage: it
+ * keeps the requests for several chunks of users in flight on one multi
+ * handle. --jobs worker threads do the CPU work. Parsing a chunk that has
+ * landed queues one render task per user on the worker's own deque; a
+ * render task writes the user's page and merges them into the team. Idle
+ * workers steal from the other deques, so a large chunk is rendered by
+ * every core instead of one, while the next chunks are still on the wire.
+ * At most PIPELINE_DEPTH chunks per worker are anywhere between request
+ * and last render. That bounds memory, and the network stage stops sending
+ * when the workers fall behind. */
+#define PIPELINE_DEPTH 2
+
+typedef struct PipelineChunk PipelineChunk;
+
+typedef struct {
+    PipelineChunk *chunk;
+    char *payload;        /* sent as-is, so kept until the request ends */
+    MemoryBuffer body;
+    const char *response; /* into body, NULL if the request failed */
+} PipelineRequest;
+
+struct PipelineChunk {
+    char *const *logins;
+    size_t count;
+    PipelineRequest *requests; /* in build_user_batch_payloads() order */
+    size_t request_count;
+    size_t unfinished;         /* requests still on the wire */
+    atomic_size_t tasks;       /* tasks that still refer to the chunk */
+    PipelineChunk *next;       /* in a retry list */
+};
+
+typedef enum {
+    TASK_PARSE,
+    TASK_RENDER
+} PipelineTaskKind;
+
+typedef struct {
+    PipelineTaskKind kind;
+    PipelineChunk *chunk;
+    Context ctx;       /* TASK_RENDER: the user, owned by the task */
+    const char *login; /* TASK_RENDER */
+} PipelineTask;
+
+/* Chase-Lev work-stealing deque in the C11 formulation of Lê et al.
+ * (PPoPP 2013): the owner pushes and takes at the bottom, other threads
+ * steal from the top. The ring never grows; the pipeline depth bounds how
+ * many tasks can exist at once, and the ring is sized for all of them. */
+typedef struct {
+    atomic_llong top;
+    atomic_llong bottom;
+    _Atomic(PipelineTask *) *slots;
+    long long mask;
+} TaskDeque;
+
+static void task_deque_init(TaskDeque *deque, size_t capacity) {
+    size_t size = 16;
+    while (size < capacity) size *= 2;
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    deque->slots = (_Atomic(PipelineTask *) *)xmalloc(size * sizeof(*deque->slots));
+    for (size_t i = 0; i < size; ++i) {
+        atomic_init(&deque->slots[i], NULL);
+    }
+    deque->mask = (long long)size - 1;
+}
+
+static void task_deque_push(TaskDeque *deque, PipelineTask *task) {
+    long long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (b - t > deque->mask) {
+        fprintf(stderr, "Pipeline task deque overflow\n");
+        exit(EXIT_FAILURE);
+    }
+    atomic_store_explicit(&deque->slots[b & deque->mask], task, memory_order_relaxed);
+    /* Publishes the task to the acquire loads of bottom in steal(). */
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_release);
+}
+
+static PipelineTask *task_deque_take(TaskDeque *deque) {
+    long long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    PipelineTask *task = NULL;
+    if (t <= b) {
+        task = atomic_load_explicit(&deque->slots[b & deque->mask], memory_order_relaxed);
+        if (t == b) {
+            /* The last task: race the thieves for it. */
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) task = NULL;
+            atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+/* NULL when the deque is empty or another thread won the race. */
+static PipelineTask *task_deque_steal(TaskDeque *deque) {
+    long long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+    PipelineTask *task = atomic_load_explicit(&deque->slots[t & deque->mask], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) return NULL;
+    return task;
+}
+
+static int task_deque_empty(TaskDeque *deque) {
+    long long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    long long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    return t >= b;
+}
+
+typedef struct {
+    BatchState *state;
+    size_t workers;
+    TaskDeque *deques;           /* one per worker, then the network stage's */
+    CURLM *multi;                /* woken whenever a chunk is done */
+    atomic_size_t open_chunks;   /* sent and not yet fully rendered */
+    _Atomic(PipelineChunk *) retries;
+    atomic_int finished;
+    /* Idle workers sleep here; pushes only lock it when someone sleeps. */
+    atomic_int sleepers;
+    pthread_mutex_t park_lock;
+    pthread_cond_t park;
+    /* Network stage only. */
+    CURL **idle;                 /* easy handles between requests */
+    size_t idle_count;
+    size_t idle_capacity;
+} Pipeline;
+
+typedef struct {
+    Pipeline *pipeline;
+    size_t index;
+} PipelineWorker;
+
+static PipelineChunk *pipeline_chunk_new(char *const *logins, size_t count) {
+    PipelineChunk *chunk = (PipelineChunk *)xmalloc(sizeof(PipelineChunk));
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->logins = logins;
+    chunk->count = count;
+    atomic_init(&chunk->tasks, 1); /* its parse task */
+    return chunk;
+}
+
+static void pipeline_chunk_free(PipelineChunk *chunk) {
+    for (size_t i = 0; i < chunk->request_count; ++i) {
+        free(chunk->requests[i].payload);
+        free(chunk->requests[i].body.data);
+    }
+    free(chunk->requests);
+    free(chunk);
+}
+
+static int pipeline_has_work(Pipeline *pipeline) {
+    for (size_t i = 0; i <= pipeline->workers; ++i) {
+        if (!task_deque_empty(&pipeline->deques[i])) return 1;
+    }
+    return 0;
+}
+
+/* Queues task on deque self, which the calling thread must own. */
+static void pipeline_push(Pipeline *pipeline, size_t self, PipelineTask *task) {
+    task_deque_push(&pipeline->deques[self], task);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&pipeline->sleepers) > 0) {
+        pthread_mutex_lock(&pipeline->park_lock);
+        pthread_cond_signal(&pipeline->park);
+        pthread_mutex_unlock(&pipeline->park_lock);
+    }
+}
+
+static PipelineTask *pipeline_find_task(Pipeline *pipeline, size_t self) {
+    PipelineTask *task = task_deque_take(&pipeline->deques[self]);
+    for (size_t k = 1; !task && k <= pipeline->workers; ++k) {
+        task = task_deque_steal(&pipeline->deques[(self + k) % (pipeline->workers + 1)]);
+    }
+    return task;
+}
+
+/* Drops one task's hold on chunk; the last one frees it and tells the
+ * network stage there is room for another. */
+static void pipeline_chunk_release(Pipeline *pipeline, PipelineChunk *chunk) {
+    if (atomic_fetch_sub(&chunk->tasks, 1) != 1) return;
+    pipeline_chunk_free(chunk);
+    atomic_fetch_sub(&pipeline->open_chunks, 1);
+    curl_multi_wakeup(pipeline->multi);
+}
+
+static void batch_count_rendered(BatchState *state, size_t rendered) {
+    pthread_mutex_lock(&state->lock);
+    state->succeeded += rendered;
+    pthread_mutex_unlock(&state->lock);
+}
+
+/* Hands count users back to the network stage to be fetched again. */
+static void pipeline_retry(Pipeline *pipeline, char *const *logins, size_t count) {
+    PipelineChunk *chunk = pipeline_chunk_new(logins, count);
+    chunk->next = atomic_load(&pipeline->retries);
+    while (!atomic_compare_exchange_weak(&pipeline->retries, &chunk->next, chunk)) {
+    }
+}
+
+/* Turns a landed chunk (or, with --from-snapshot, its snapshot files) into
+ * one render task per user. */
+static void pipeline_parse(Pipeline *pipeline, PipelineChunk *chunk, size_t self) {
+    BatchState *state = pipeline->state;
+    const Options *options = state->options;
+    size_t count = chunk->count;
+    Context *contexts = (Context *)xmalloc(count * sizeof(Context));
+    int *ok = (int *)xmalloc(count * sizeof(int));
+    int status = 0;
+
+    if (options->from_snapshot) {
+        for (size_t i = 0; i < count; ++i) {
+            char path[1100];
+            batch_snapshot_path(options->from_snapshot, chunk->logins[i], path, sizeof(path));
+            ok[i] = load_snapshot(path, &contexts[i]) == 0;
+        }
+    } else {
+        const char **responses = (const char **)xmalloc(chunk->request_count * sizeof(char *));
+        for (size_t i = 0; i < chunk->request_count; ++i) {
+            responses[i] = chunk->requests[i].response;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            context_init(&contexts[i]);
+        }
+        status = parse_user_batch(chunk->logins, count, options->years, responses, contexts, ok);
+        free(responses);
+        for (size_t i = 0; i < chunk->request_count; ++i) {
+            free(chunk->requests[i].body.data);
+            chunk->requests[i].body.data = NULL;
+        }
+    }
+
+    if (status != 0) {
+        for (size_t i = 0; i < count; ++i) {
+            free_context(&contexts[i]);
+        }
+        if (count > 1 && !(options->deadline && options->deadline <= monotonic_ms())) {
+            /* Oversized aliased queries can hit GitHub's request timeout;
+             * retry as two smaller queries before giving up on anyone. */
+            pipeline_retry(pipeline, chunk->logins, count / 2);
+            pipeline_retry(pipeline, chunk->logins + count / 2, count - count / 2);
+        } else {
+            size_t rendered = 0;
+            for (size_t i = 0; i < count; ++i) {
+                batch_fall_back(state, chunk->logins[i], &rendered);
+            }
+            batch_count_rendered(state, rendered);
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            if (!ok[i]) {
+                if (!options->from_snapshot) free_context(&contexts[i]);
+                continue;
+            }
+            PipelineTask *task = (PipelineTask *)xmalloc(sizeof(PipelineTask));
+            task->kind = TASK_RENDER;
+            task->chunk = chunk;
+            task->ctx = contexts[i];
+            task->login = chunk->logins[i];
+            atomic_fetch_add(&chunk->tasks, 1);
+            pipeline_push(pipeline, self, task);
+        }
+    }
+    free(contexts);
+    free(ok);
+}
+
+static void pipeline_run_task(Pipeline *pipeline, PipelineTask *task, size_t self) {
+    PipelineChunk *chunk = task->chunk;
+    if (task->kind == TASK_PARSE) {
+        pipeline_parse(pipeline, chunk, self);
+    } else {
+        size_t rendered = 0;
+        batch_finish_context(pipeline->state, &task->ctx, task->login, !pipeline->state->options->from_snapshot, &rendered);
+        batch_count_rendered(pipeline->state, rendered);
+    }
+    free(task);
+    pipeline_chunk_release(pipeline, chunk);
+}
+
+static void *pipeline_worker_main(void *arg) {
+    PipelineWorker *worker = (PipelineWorker *)arg;
+    Pipeline *pipeline = worker->pipeline;
+    for (;;) {
+        PipelineTask *task = pipeline_find_task(pipeline, worker->index);
+        if (task) {
+            pipeline_run_task(pipeline, task, worker->index);
+            continue;
+        }
+        pthread_mutex_lock(&pipeline->park_lock);
+        atomic_fetch_add(&pipeline->sleepers, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        while (!pipeline_has_work(pipeline) && !atomic_load(&pipeline->finished)) {
+            pthread_cond_wait(&pipeline->park, &pipeline->park_lock);
+        }
+        atomic_fetch_sub(&pipeline->sleepers, 1);
+        int finished = atomic_load(&pipeline->finished);
+        pthread_mutex_unlock(&pipeline->park_lock);
+        if (finished) break;
+    }
+    return NULL;
+}
+
+/* A chunk whose requests have all ended goes to the workers. */
+static void pipeline_submit_parse(Pipeline *pipeline, PipelineChunk *chunk) {
+    PipelineTask *task = (PipelineTask *)xmalloc(sizeof(PipelineTask));
+    task->kind = TASK_PARSE;
+    task->chunk = chunk;
+    task->login = NULL;
+    pipeline_push(pipeline, pipeline->workers, task);
+}
+
+/* Puts every request of chunk on the multi handle. */
+static void pipeline_send(Pipeline *pipeline, HttpClient *client, PipelineChunk *chunk) {
+    if (!client->curl) {
+        pipeline_submit_parse(pipeline, chunk);
+        return;
+    }
+    int years = pipeline->state->options->years;
+    size_t total = user_batch_request_count(chunk->count, years);
+    char **payloads = (char **)xmalloc(total * sizeof(char *));
+    build_user_batch_payloads(chunk->logins, chunk->count, years, payloads);
+    chunk->requests = (PipelineRequest *)xmalloc(total * sizeof(PipelineRequest));
+    memset(chunk->requests, 0, total * sizeof(PipelineRequest));
+    chunk->request_count = total;
+    size_t skipped = 0;
+    for (size_t i = 0; i < total; ++i) {
+        PipelineRequest *request = &chunk->requests[i];
+        request->chunk = chunk;
+        request->payload = payloads[i];
+        CURL *handle = pipeline->idle_count ? pipeline->idle[--pipeline->idle_count] : curl_easy_duphandle(client->curl);
+        if (!handle || http_limit_to_deadline(client, handle) != 0) {
+            if (handle) pipeline->idle[pipeline->idle_count++] = handle;
+            skipped++;
+            continue;
+        }
+        curl_easy_setopt(handle, CURLOPT_URL, graphql_endpoint());
+        curl_easy_setopt(handle, CURLOPT_POSTFIELDS, request->payload);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, (void *)&request->body);
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, (void *)request);
+        curl_multi_add_handle(pipeline->multi, handle);
+        chunk->unfinished++;
+    }
+    free(payloads);
+    if (skipped) {
+        fprintf(stderr, "Deadline passed; %zu requests not sent\n", skipped);
+    }
+    if (chunk->unfinished == 0) {
+        pipeline_submit_parse(pipeline, chunk);
+    }
+}
+
+/* Collects the requests that have ended and passes on complete chunks. */
+static void pipeline_receive(Pipeline *pipeline) {
+    int running = 0;
+    CURLMcode mc = curl_multi_perform(pipeline->multi, &running);
+    if (mc != CURLM_OK) {
+        fprintf(stderr, "Request failed: %s\n", curl_multi_strerror(mc));
+    }
+    CURLMsg *msg;
+    int pending;
+    while ((msg = curl_multi_info_read(pipeline->multi, &pending))) {
+        if (msg->msg != CURLMSG_DONE) continue;
+        PipelineRequest *request = NULL;
+        CURL *handle = msg->easy_handle;
+        curl_easy_getinfo(handle, CURLINFO_PRIVATE, (char **)&request);
+        request->response = http_finished_body(msg, &request->body);
+        curl_multi_remove_handle(pipeline->multi, handle);
+        if (pipeline->idle_count == pipeline->idle_capacity) {
+            pipeline->idle_capacity = pipeline->idle_capacity ? pipeline->idle_capacity * 2 : 16;
+            pipeline->idle = (CURL **)realloc(pipeline->idle, pipeline->idle_capacity * sizeof(CURL *));
+            if (!pipeline->idle) {
+                fprintf(stderr, "Out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        pipeline->idle[pipeline->idle_count++] = handle;
+        if (--request->chunk->unfinished == 0) {
+            pipeline_submit_parse(pipeline, request->chunk);
+        }
+    }
+}
+
+/* Runs the whole --batch list through the pipeline with workers threads
+ * and chunks of at most chunk_size users. client is uninitialized (zeroed)
+ * with --from-snapshot; its multi handle still serves as the network
+ * stage's sleep. */
+static void batch_pipeline_run(BatchState *state, HttpClient *client, size_t workers, size_t chunk_size) {
+    Pipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.state = state;
+    pipeline.multi = http_client_multi(client);
+    if (!pipeline.multi) {
+        return;
+    }
+    size_t window = PIPELINE_DEPTH * workers;
+    size_t request_max = user_batch_request_count(chunk_size, state->options->years);
+    pipeline.idle_capacity = window * request_max;
+    pipeline.idle = (CURL **)xmalloc(pipeline.idle_capacity * sizeof(CURL *));
+    pthread_mutex_init(&pipeline.park_lock, NULL);
+    pthread_cond_init(&pipeline.park, NULL);
+
+    PipelineWorker *threads = (PipelineWorker *)xmalloc(workers * sizeof(PipelineWorker));
+    pthread_t *ids = (pthread_t *)xmalloc(workers * sizeof(pthread_t));
+    size_t started = 0;
+    pipeline.workers = workers;
+    pipeline.deques = (TaskDeque *)xmalloc((workers + 1) * sizeof(TaskDeque));
+    for (size_t i = 0; i <= workers; ++i) {
+        task_deque_init(&pipeline.deques[i], window * (chunk_size + 1));
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        threads[i].pipeline = &pipeline;
+        threads[i].index = i;
+        if (pthread_create(&ids[started], NULL, pipeline_worker_main, &threads[i]) == 0) {
+            started++;
+        }
+    }
+
+    const LoginList *logins = state->logins;
+    size_t next = 0;
+    PipelineChunk *waiting = NULL;
+    for (;;) {
+        /* Retried halves go out before users not yet tried. */
+        PipelineChunk *retried = atomic_exchange(&pipeline.retries, NULL);
+        while (retried) {
+            PipelineChunk *chunk = retried;
+            retried = chunk->next;
+            chunk->next = waiting;
+            waiting = chunk;
+        }
+        while (atomic_load(&pipeline.open_chunks) < window && (waiting || next < logins->size)) {
+            PipelineChunk *chunk = waiting;
+            if (chunk) {
+                waiting = chunk->next;
+            } else {
+                size_t count = logins->size - next < chunk_size ? logins->size - next : chunk_size;
+                chunk = pipeline_chunk_new(logins->items + next, count);
+                next += count;
+            }
+            atomic_fetch_add(&pipeline.open_chunks, 1);
+            pipeline_send(&pipeline, client, chunk);
+        }
+        if (!waiting && next == logins->size && atomic_load(&pipeline.open_chunks) == 0 && !atomic_load(&pipeline.retries)) {
+            break;
+        }
+        pipeline_receive(&pipeline);
+        if (started == 0) {
+            /* No worker thread could start; do their work here. */
+            PipelineTask *task = pipeline_find_task(&pipeline, workers);
+            if (task) {
+                pipeline_run_task(&pipeline, task, workers);
+                continue;
+            }
+        }
+        curl_multi_poll(pipeline.multi, NULL, 0, 1000, NULL);
+    }
+
+    atomic_store(&pipeline.finished, 1);
+    pthread_mutex_lock(&pipeline.park_lock);
+    pthread_cond_broadcast(&pipeline.park);
+    pthread_mutex_unlock(&pipeline.park_lock);
+    for (size_t i = 0; i < started; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+    for (size_t i = 0; i < pipeline.idle_count; ++i) {
+        curl_easy_cleanup(pipeline.idle[i]);
+    }
+    for (size_t i = 0; i <= workers; ++i) {
+        free(pipeline.deques[i].slots);
+    }
+    free(pipeline.deques);
+    free(pipeline.idle);
+    free(threads);
+    free(ids);
+    pthread_cond_destroy(&pipeline.park);
+    pthread_mutex_destroy(&pipeline.park_lock);
+}
+
+/* Writes the --team dashboard to <output-dir>/teams/<name>/index.html. */
+static int render_team_page(Team *team, const Options *options, Compressor *compressor) {
+    Context *ctx = &team->ctx;
+    context_finalize(ctx);
+    qsort(ctx->members.items, ctx->members.size, sizeof(TeamMember), compare_team_members);
+
+    char dir[1024];
+    char path[1100];
+    snprintf(dir, sizeof(dir), "%s/teams/%s", options->output_dir, ctx->login);
+    snprintf(path, sizeof(path), "%s/index.html", dir);
+    if (ensure_directory(dir) != 0) {
+        return -1;
+    }
+    if (options->history) {
+        context_attach_history(ctx, dir, !options->from_snapshot);
+    }
+    ContributionStats activity;
+    compute_contribution_stats(&ctx->contributions, &activity);
+    int status = write_html(ctx, &activity, path, "../../", options->cache_dir, options->write_flags);
+    if (status >= 0) {
+        compressor_push(compressor, path, status == 0);
+        printf(status == 0 ? "Team dashboard for %s (%zu members) -> %s\n" : "No changes for team %s (%zu members, %s)\n", ctx->login, ctx->members.size, path);
+        if (options->outputs && write_outputs(ctx, &activity, dir, compressor) < 0) {
+            status = -1;
+        }
+    }
+    contribution_stats_free(&activity);
+    return status >= 0 ? 0 : -1;
+}
+
+static int run_batch(const Options *options, const char *token) {
+    LoginList logins = {0};
+    if (read_login_list(options->batch_path, &logins) != 0 && logins.size == 0) {
+        login_list_free(&logins);
+        return EXIT_FAILURE;
+    }
+    if (logins.size == 0) {
+        fprintf(stderr, "No logins found in %s\n", options->batch_path);
+        login_list_free(&logins);
+        return EXIT_FAILURE;
+    }
+
+    if ((options->save_snapshot && ensure_directory(options->save_snapshot) != 0) ||
+        (options->cache_dir && ensure_directory(options->cache_dir) != 0)) {
+        login_list_free(&logins);
+        return EXIT_FAILURE;
+    }
+
+    HttpClient client;
+    if (options->from_snapshot) {
+        memset(&client, 0, sizeof(client));
+    } else if (http_client_init(&client, token) != 0) {
+        login_list_free(&logins);
+        return EXIT_FAILURE;
+    }
+    client.deadline = options->deadline;
+
+    Team team;
+    if (options->team) {
+        team_init(&team, options->team);
+    }
+
+    Compressor compressor;
+    int precompress = options->precompress && compressor_start(&compressor) == 0;
+    if (precompress) {
+        compressor_push_stylesheet(&compressor, options->output_dir);
+    }
+
+    BatchState state;
+    state.logins = &logins;
+    state.options = options;
+    state.team = options->team ? &team : NULL;
+    state.compressor = precompress ? &compressor : NULL;
+    state.succeeded = 0;
+    pthread_mutex_init(&state.lock, NULL);
+
+    size_t jobs = (size_t)options->jobs;
+    if (jobs > logins.size) jobs = logins.size;
+
+    /* Spread small lists across several requests instead of packing them
+     * all into one. */
+    size_t chunk = graphql_batch_capacity((size_t)options->batch_size);
+    size_t per_worker = (logins.size + jobs - 1) / jobs;
+    batch_pipeline_run(&state, &client, jobs, per_worker < chunk ? per_worker : chunk);
+
+    size_t failed = logins.size - state.succeeded;
+    printf("Batch complete: %zu of %zu dashboards written to %s/\n", state.succeeded, logins.size, options->output_dir);
+    if (options->team) {
+        if (team.ctx.members.size == 0 || render_team_page(&team, options, state.compressor) != 0) {
+            failed++;
+        }
+        team_free(&team);
+    }
+    if (precompress) {
+        compressor_finish(&compressor);
+    } else if (options->precompress) {
+        failed++;
+    }
+
+    pthread_mutex_destroy(&state.lock);
+    http_client_cleanup(&client);
+    login_list_free(&logins);
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Fetches the single user or organization (or loads the snapshot) that a
+ * non-batch run renders. */
+static int load_context(const Options *options, const char *token, Context *ctx) {
+    const char *username = getenv("GITHUB_USERNAME");
+    if (!options->org && !options->from_snapshot && (!username || strlen(username) == 0)) {
+        fprintf(stderr, "Missing GITHUB_USERNAME environment variable.\n");
+        return -1;
+    }
+    if (!options->org && !options->from_snapshot && !is_valid_login(username)) {
+        fprintf(stderr, "GITHUB_USERNAME '%s' is not a valid GitHub login.\n", username);
+        return -1;
+    }
+    if (options->from_snapshot) {
+        return load_snapshot(options->from_snapshot, ctx) == 0 ? 0 : -1;
+    }
+    HttpClient client;
+    if (http_client_init(&client, token) != 0) {
+        return -1;
+    }
+    client.deadline = options->deadline;
+    int fetched;
+    if (options->org) {
+        context_init(ctx);
+        fetched = fetch_org_context(&client, options->org, ctx);
+        if (fetched != 0) free_context(ctx);
+    } else {
+        fetched = fetch_user_context(&client, username, options->years, ctx);
+    }
+    http_client_cleanup(&client);
+    return fetched == 0 ? 0 : -1;
+}
+
+/* Writes the page and data outputs of a non-batch run into output_dir. */
+static int render_single_page(Context *ctx, const Options *options, int fresh, Compressor *compressor) {
+    if (options->history) {
+        context_attach_history(ctx, options->output_dir, fresh);
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/index.html", options->output_dir);
+    ContributionStats activity;
+    compute_contribution_stats(&ctx->contributions, &activity);
+    int status = write_html(ctx, &activity, path, "", options->cache_dir, options->write_flags);
+    if (status == 0) {
+        printf("Site updated for %s -> %s\n", ctx->login, path);
+    } else if (status == 1) {
+        printf("No changes for %s; %s left as is\n", ctx->login, path);
+    }
+    if (status >= 0) {
+        compressor_push(compressor, path, status == 0);
+    }
+    if (status >= 0 && options->outputs) {
+        int written = write_outputs(ctx, &activity, options->output_dir, compressor);
+        if (written < 0) {
+            status = -1;
+        } else if (written > 0) {
+            printf("Updated %d data file%s in %s\n", written, written == 1 ? "" : "s", options->output_dir);
+        }
+    }
+    contribution_stats_free(&activity);
+    return status >= 0 ? 0 : -1;
+}
+
+/* Renders a single user, or the organization named by --org. */
+static int run_single(const Options *options, const char *token) {
+    if (options->cache_dir && ensure_directory(options->cache_dir) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    /* With --deadline, a fetch that fails or runs out of time falls back to
+     * the last snapshot rather than failing the run. */
+    Context ctx;
+    if (load_context(options, token, &ctx) != 0 &&
+        (!options->deadline || !options->save_snapshot || load_stale_context(options->save_snapshot, &ctx) != 0)) {
+        return EXIT_FAILURE;
+    }
+    int fresh = !options->from_snapshot && !(ctx.stale & STALE_ALL);
+    if (fresh) {
+        context_backfill_contributions(&ctx, options->save_snapshot);
+    }
+    if (options->save_snapshot && !(ctx.stale & STALE_ALL)) {
+        write_snapshot(&ctx, options->save_snapshot);
+    }
+
+    /* The stylesheet compresses while the page renders. */
+    Compressor compressor;
+    if (options->precompress) {
+        if (compressor_start(&compressor) != 0) {
+            free_context(&ctx);
+            return EXIT_FAILURE;
+        }
+        compressor_push_stylesheet(&compressor, options->output_dir);
+    }
+
+    Compressor *pending = options->precompress ? &compressor : NULL;
+    int status = render_single_page(&ctx, options, fresh, pending);
+    if (pending) {
+        compressor_finish(pending);
+    }
+
+    free_context(&ctx);
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ------------------------------ Daemon mode ----------------------------- */
+
+/* --daemon stays resident and rewrites each dashboard on its own interval
+ * instead of paying curl setup, the TLS handshake and a cold heap on every
+ * scheduled run. One HttpClient lives for the whole process, so refreshes
+ * reuse its connection and response buffers, and each entry keeps its
+ * Context between refreshes: it is recycled rather than freed, and the next
+ * fetch refills the same lists. When the fetched data hashes the same as the
+ * data behind the pages on disk, rendering and all file I/O are skipped.
+ * A failed fetch is retried after DAEMON_RETRY_SECONDS, doubling with each
+ * further failure up to the entry's interval. */
+
+#define DAEMON_RETRY_SECONDS 60
+
+typedef struct {
+    const char *login;
+    int interval;
+    time_t due;
+    int failures;    /* fetches failed in a row */
+    uint64_t digest; /* data the published pages came from, 0 before the first */
+    Context ctx;
+} DaemonEntry;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop_signal(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+/* Everything the outputs read from a fetched context. The day number is
+ * mixed in because the rolling windows move on at midnight even when the
+ * data does not. */
+static uint64_t context_data_digest(const Context *ctx) {
+    uint64_t hash = hash_number(FNV_OFFSET_BASIS, (long long)(time(NULL) / 86400));
+    hash = hash_text(hash, ctx->login);
+    hash = hash_text(hash, ctx->name);
+    hash = hash_text(hash, ctx->avatar_url);
+    hash = hash_text(hash, ctx->bio);
+    hash = hash_text(hash, ctx->location);
+    hash = hash_text(hash, ctx->blog);
+    hash = hash_number(hash, ctx->followers);
+    hash = hash_number(hash, ctx->following);
+    hash = hash_number(hash, ctx->public_repos);
+    hash = hash_number(hash, ctx->total_stars);
+    hash = hash_number(hash, ctx->total_forks);
+    hash = hash_number(hash, ctx->total_contributions);
+    for (size_t i = 0; i < ctx->top_repos.size; ++i) {
+        const RepoEntry *repo = &ctx->top_repos.items[i];
+        hash = hash_text(hash, repo->name);
+        hash = hash_text(hash, repo->description);
+        hash = hash_text(hash, repo->language);
+        hash = hash_text(hash, repo->url);
+        hash = hash_text(hash, repo->updated_at);
+        hash = hash_number(hash, repo->stars);
+        hash = hash_number(hash, repo->forks);
+    }
+    for (size_t i = 0; i < ctx->languages.size; ++i) {
+        hash = hash_text(hash, ctx->languages.items[i].language);
+        hash = hash_number(hash, ctx->languages.items[i].bytes);
+    }
+    return hash_contributions(hash, &ctx->contributions);
+}
+
+/* Publishes a freshly fetched entry the way a one-off run would. */
+static int daemon_publish(DaemonEntry *entry, const Options *options, Compressor *compressor) {
+    Context *ctx = &entry->ctx;
+    if (options->batch_path) {
+        /* Same as batch mode: paths use the requested spelling. */
+        free(ctx->login);
+        ctx->login = _strdup(entry->login);
+    }
+    char snapshot[1100] = "";
+    if (options->save_snapshot) {
+        if (options->batch_path) {
+            batch_snapshot_path(options->save_snapshot, entry->login, snapshot, sizeof(snapshot));
+        } else {
+            snprintf(snapshot, sizeof(snapshot), "%s", options->save_snapshot);
+        }
+        context_backfill_contributions(ctx, snapshot);
+    }
+    uint64_t digest = context_data_digest(ctx);
+    if (digest == entry->digest && !(options->write_flags & WRITE_FORCE)) {
+        printf("No changes for %s since the last refresh\n", entry->login);
+        return 0;
+    }
+    if (snapshot[0]) {
+        write_snapshot(ctx, snapshot);
+    }
+    int status = options->batch_path ? render_user_page(ctx, options, 1, compressor)
+                                     : render_single_page(ctx, options, 1, compressor);
+    if (status == 0) {
+        entry->digest = digest;
+    }
+    return status;
+}
+
+/* Seconds until an entry that just failed is fetched again. */
+static int daemon_retry_delay(const DaemonEntry *entry) {
+    int delay = DAEMON_RETRY_SECONDS;
+    for (int i = 1; i < entry->failures && delay < entry->interval; ++i) {
+        delay *= 2;
+    }
+    return delay < entry->interval ? delay : entry->interval;
+}
+
+/* Fetches the picked users into their own recycled contexts with one
+ * aliased query. If the query itself fails, the two halves are tried on
+ * their own before anyone in it is marked as failed, as in batch mode. */
+static void daemon_fetch_users(DaemonEntry *entries, const size_t *picked, size_t count, const Options *options, HttpClient *client,
+                               char **logins, Context *contexts, int *ok) {
+    for (size_t k = 0; k < count; ++k) {
+        DaemonEntry *entry = &entries[picked[k]];
+        context_recycle(&entry->ctx);
+        contexts[k] = entry->ctx;
+        logins[k] = (char *)entry->login;
+    }
+    int fetched = fetch_user_batch(client, logins, count, options->years, contexts, ok);
+    for (size_t k = 0; k < count; ++k) {
+        entries[picked[k]].ctx = contexts[k];
+    }
+    if (fetched != 0 && count > 1) {
+        size_t half = count / 2;
+        daemon_fetch_users(entries, picked, half, options, client, logins, contexts, ok);
+        daemon_fetch_users(entries, picked + half, count - half, options, client, logins + half, contexts + half, ok + half);
+    }
+}
+
+/* Fetches the picked entries (or the organization's pages) and publishes
+ * each one that arrived. */
+static void daemon_refresh(DaemonEntry *entries, const size_t *picked, size_t count, const Options *options, HttpClient *client,
+                           char **logins, Context *contexts, int *ok, Compressor *compressor) {
+    time_t now = time(NULL);
+    if (options->org) {
+        DaemonEntry *entry = &entries[picked[0]];
+        context_recycle(&entry->ctx);
+        ok[0] = fetch_org_context(client, options->org, &entry->ctx) == 0;
+    } else {
+        daemon_fetch_users(entries, picked, count, options, client, logins, contexts, ok);
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+        DaemonEntry *entry = &entries[picked[k]];
+        if (!ok[k]) {
+            entry->failures += 1;
+            int delay = daemon_retry_delay(entry);
+            entry->due = now + delay;
+            fprintf(stderr, "Refresh failed for %s; keeping the last pages and retrying in %d s\n", entry->login, delay);
+            continue;
+        }
+        entry->failures = 0;
+        entry->due = now + entry->interval;
+        if (daemon_publish(entry, options, compressor) != 0) {
+            fprintf(stderr, "Failed to write the pages for %s\n", entry->login);
+        }
+    }
+}
+
+static int run_daemon(const Options *options, const char *token) {
+    LoginList logins = {0};
+    if (options->batch_path) {
+        if (read_login_list(options->batch_path, &logins) != 0 && logins.size == 0) {
+            login_list_free(&logins);
+            return EXIT_FAILURE;
+        }
+        if (logins.size == 0) {
+            fprintf(stderr, "No logins found in %s\n", options->batch_path);
+            login_list_free(&logins);
+            return EXIT_FAILURE;
+        }
+    } else {
+        const char *login = options->org ? options->org : getenv("GITHUB_USERNAME");
+        if (!login || !is_valid_login(login)) {
+            fprintf(stderr, "GITHUB_USERNAME is missing or not a valid GitHub login.\n");
+            return EXIT_FAILURE;
+        }
+        login_list_push(&logins, login, 0);
+    }
+    if ((options->batch_path && options->save_snapshot && ensure_directory(options->save_snapshot) != 0) ||
+        (options->cache_dir && ensure_directory(options->cache_dir) != 0)) {
+        login_list_free(&logins);
+        return EXIT_FAILURE;
+    }
+
+    HttpClient client;
+    if (http_client_init(&client, token) != 0) {
+        login_list_free(&logins);
+        return EXIT_FAILURE;
+    }
+
+    time_t now = time(NULL);
+    DaemonEntry *entries = (DaemonEntry *)xmalloc(logins.size * sizeof(DaemonEntry));
+    for (size_t i = 0; i < logins.size; ++i) {
+        entries[i].login = logins.items[i];
+        entries[i].interval = logins.intervals[i] ? logins.intervals[i] : options->refresh;
+        entries[i].due = now;
+        entries[i].failures = 0;
+        entries[i].digest = 0;
+        context_init(&entries[i].ctx);
+    }
+    /* Due entries are fetched together, up to one aliased query at a time;
+     * the scratch arrays for that are allocated once. */
+    size_t chunk = options->org ? 1 : graphql_batch_capacity((size_t)options->batch_size);
+    size_t *picked = (size_t *)xmalloc(chunk * sizeof(size_t));
+    char **names = (char **)xmalloc(chunk * sizeof(char *));
+    Context *contexts = (Context *)xmalloc(chunk * sizeof(Context));
+    int *ok = (int *)xmalloc(chunk * sizeof(int));
+
+    signal(SIGINT, handle_stop_signal);
+    signal(SIGTERM, handle_stop_signal);
+    printf("Refreshing %zu dashboard%s into %s/; stop with Ctrl-C\n", logins.size, logins.size == 1 ? "" : "s", options->output_dir);
+    fflush(stdout);
+
+    while (!stop_requested) {
+        now = time(NULL);
+        time_t next = now + options->refresh;
+        size_t count = 0;
+        for (size_t i = 0; i < logins.size; ++i) {
+            if (entries[i].due <= now && count < chunk) {
+                picked[count++] = i;
+            } else if (entries[i].due < next) {
+                next = entries[i].due;
+            }
+        }
+        if (count > 0) {
+            Compressor compressor;
+            int precompress = options->precompress && compressor_start(&compressor) == 0;
+            if (precompress) {
+                compressor_push_stylesheet(&compressor, options->output_dir);
+            }
+            daemon_refresh(entries, picked, count, options, &client, names, contexts, ok, precompress ? &compressor : NULL);
+            if (precompress) {
+                compressor_finish(&compressor);
+            }
+            fflush(stdout);
+            continue;
+        }
+        /* Short naps keep Ctrl-C prompt on every platform. */
+        while (!stop_requested && time(NULL) < next) {
+            sleep_seconds(1);
+        }
+    }
+
+    for (size_t i = 0; i < logins.size; ++i) {
+        free_context(&entries[i].ctx);
+    }
+    free(entries);
+    free(picked);
+    free(names);
+    free(contexts);
+    free(ok);
+    http_client_cleanup(&client);
+    login_list_free(&logins);
+    printf("Daemon stopped\n");
+    return EXIT_SUCCESS;
+}
+
+/* ------------------------------- Serve mode ----------------------------- */
+
+/* --serve keeps the page, its assets, the secondary outputs and their
+ * encoded variants in memory and answers HTTP from one epoll loop, so a
+ * request never touches the disk or waits on GitHub. A refresh thread
+ * rebuilds the whole Site on a timer and hands it to the loop, which swaps
+ * it in between events; responses still being sent keep the old one alive
+ * through a reference count that only the loop touches.
+ *
+ * With --webhook the loop also takes signed GitHub webhooks on POST
+ * /webhook. Push, star and fork events for the dashboard owner's
+ * repositories are queued for the refresh thread, which waits for a quiet
+ * moment, applies them to the Context it kept from the last fetch and
+ * renders again: star and fork payloads carry the repository's new state,
+ * so only a push costs a request, for the recent calendar. */
+#ifdef HAVE_EPOLL
+
+#define SERVE_REQUEST_MAX 8192
+#define SERVE_IDLE_SECONDS 30
+#define SERVE_MAX_VARIANTS 4
+#define SERVE_WEBHOOK_MAX (1024 * 1024)
+#define SERVE_WEBHOOK_DEBOUNCE 10 /* seconds after the first queued event */
+#define SERVE_WEBHOOK_DELIVERIES 64 /* recent X-GitHub-Delivery IDs kept */
+
+typedef struct {
+    const char *coding; /* Content-Encoding, NULL for the identity body */
+    MemoryBuffer body;
+    char etag[32];
+} SiteVariant;
+
+typedef struct {
+    char *path;
+    const char *type;
+    SiteVariant variants[SERVE_MAX_VARIANTS]; /* identity first */
+    size_t variant_count;
+} SiteFile;
+
+typedef struct {
+    SiteFile *files;
+    size_t count;
+    size_t capacity;
+    int refs;
+    char generated_at[32];
+} Site;
+
+static const char *content_type(const char *path) {
+    static const char *const TYPES[][2] = {
+        {".html", "text/html; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".json", "application/json"},
+        {".svg", "image/svg+xml"},
+        {".md", "text/markdown; charset=utf-8"},
+    };
+    size_t length = strlen(path);
+    for (size_t i = 0; i < sizeof(TYPES) / sizeof(TYPES[0]); ++i) {
+        size_t suffix = strlen(TYPES[i][0]);
+        if (length >= suffix && strcmp(path + length - suffix, TYPES[i][0]) == 0) return TYPES[i][1];
+    }
+    return "application/octet-stream";
+}
+
+/* Adds body under path, taking ownership, along with every encoding that
+ * comes out smaller. ETags hash the identity body; encoded variants get a
+ * suffix so caches never mix them up. */
+static void site_add(Site *site, const char *path, MemoryBuffer *body) {
+    if (site->count == site->capacity) {
+        site->capacity = site->capacity ? site->capacity * 2 : 16;
+        site->files = (SiteFile *)realloc(site->files, site->capacity * sizeof(SiteFile));
+        if (!site->files) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    SiteFile *file = &site->files[site->count++];
+    memset(file, 0, sizeof(*file));
+    file->path = _strdup(path);
+    file->type = content_type(path);
+    unsigned long long digest = (unsigned long long)fnv1a64(FNV_OFFSET_BASIS, body->data, body->size);
+    SiteVariant *identity = &file->variants[file->variant_count++];
+    identity->body = *body;
+    snprintf(identity->etag, sizeof(identity->etag), "\"%016llx\"", digest);
+    for (const Encoder *encoder = ENCODERS; encoder->suffix && file->variant_count < SERVE_MAX_VARIANTS; ++encoder) {
+        MemoryBuffer packed = {0};
+        if (encoder->encode((const unsigned char *)identity->body.data, identity->body.size, &packed) == 0 && packed.size < identity->body.size) {
+            SiteVariant *variant = &file->variants[file->variant_count++];
+            variant->coding = encoder->coding;
+            variant->body = packed;
+            snprintf(variant->etag, sizeof(variant->etag), "\"%016llx-%s\"", digest, encoder->coding);
+        } else {
+            free(packed.data);
+        }
+    }
+}
+
+static void site_release(Site *site) {
+    if (!site || --site->refs > 0) return;
+    for (size_t i = 0; i < site->count; ++i) {
+        free(site->files[i].path);
+        for (size_t k = 0; k < site->files[i].variant_count; ++k) {
+            free(site->files[i].variants[k].body.data);
+        }
+    }
+    free(site->files);
+    free(site);
+}
+
+/* Renders everything a run would write into output_dir, in memory. With
+ * --cache-dir, page sections whose data did not change are copied from the
+ * section cache instead of being rendered again. */
+static Site *site_build(const Context *ctx, const Options *options) {
+    Site *site = (Site *)xmalloc(sizeof(Site));
+    memset(site, 0, sizeof(*site));
+    site->refs = 1;
+    memcpy(site->generated_at, ctx->generated_at, sizeof(site->generated_at));
+
+    char data_name[32] = "";
+    if (options->write_flags & WRITE_SPLIT_DATA) {
+        MemoryBuffer data = {0};
+        write_page_data(&data, ctx);
+        snprintf(data_name, sizeof(data_name), "data.%016llx.json", (unsigned long long)fnv1a64(FNV_OFFSET_BASIS, data.data, data.size));
+        char path[40];
+        snprintf(path, sizeof(path), "/%s", data_name);
+        site_add(site, path, &data);
+    }
+    ContributionStats activity;
+    compute_contribution_stats(&ctx->contributions, &activity);
+    SectionCache cache = {options->cache_dir, fnv1a64(FNV_OFFSET_BASIS, "/index.html", strlen("/index.html"))};
+    MemoryBuffer page = {0};
+    render_html(ctx, &activity, "", options->cache_dir ? &cache : NULL, options->write_flags, data_name[0] ? data_name : NULL, &page);
+    site_add(site, "/index.html", &page);
+
+    char path[1100];
+    snprintf(path, sizeof(path), "%s/assets/styles.css", options->output_dir);
+    FileView view;
+    if (file_view_open(path, &view) == 0) {
+        MemoryBuffer stylesheet = {0};
+        buffer_append(&stylesheet, (const char *)view.data, view.size);
+        file_view_close(&view);
+        site_add(site, "/assets/styles.css", &stylesheet);
     } else {
-        fprintf(fp, "                <canvas id=\"contributionChart\" width=\"600\" height=\"320\" role=\"img\" aria-label=\"Contribution activity chart\"></canvas>\n");
+        fprintf(stderr, "Cannot read %s; serving the page without it\n", path);
+    }
+
+    if (options->outputs) {
+        for (const Renderer *renderer = RENDERERS; renderer->name; ++renderer) {
+            if (renderer->personal && ctx->kind == CONTEXT_ORG) continue;
+            MemoryBuffer out = {0};
+            renderer->render(ctx, &activity, &out);
+            snprintf(path, sizeof(path), "/%s", renderer->name);
+            site_add(site, path, &out);
+        }
+    }
+    contribution_stats_free(&activity);
+    return site;
+}
+
+/* Fetches the data a Site is built from, with its history attached. */
+static int site_fetch(const Options *options, const char *token, Context *ctx) {
+    if (load_context(options, token, ctx) != 0) {
+        return -1;
+    }
+    if (options->history) {
+        context_attach_history(ctx, options->output_dir, !options->from_snapshot);
+    }
+    return 0;
+}
+
+static const SiteFile *site_find(const Site *site, const char *path, size_t length) {
+    char name[256];
+    if (length == 0 || length + sizeof("index.html") > sizeof(name)) return NULL;
+    memcpy(name, path, length);
+    name[length] = '\0';
+    if (name[length - 1] == '/') memcpy(name + length, "index.html", sizeof("index.html"));
+    for (size_t i = 0; i < site->count; ++i) {
+        if (strcmp(site->files[i].path, name) == 0) return &site->files[i];
+    }
+    return NULL;
+}
+
+/* ----- Webhook signatures: SHA-256 (FIPS 180-4) and HMAC (RFC 2104) ----- */
+
+typedef struct {
+    uint32_t state[8];
+    unsigned char block[64];
+    size_t used;         /* bytes waiting in block */
+    uint64_t length;     /* total bytes hashed */
+} Sha256;
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_init(Sha256 *sha) {
+    static const uint32_t INITIAL[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    memcpy(sha->state, INITIAL, sizeof(INITIAL));
+    sha->used = 0;
+    sha->length = 0;
+}
+
+static void sha256_block(Sha256 *sha, const unsigned char *block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 | (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; ++i) {
+        uint32_t s0 = SHA256_ROTR(w[i - 15], 7) ^ SHA256_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = SHA256_ROTR(w[i - 2], 17) ^ SHA256_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
     }
-    fprintf(fp, "            </div>\n        </section>\n");
+    uint32_t a = sha->state[0], b = sha->state[1], c = sha->state[2], d = sha->state[3];
+    uint32_t e = sha->state[4], f = sha->state[5], g = sha->state[6], h = sha->state[7];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    sha->state[0] += a;
+    sha->state[1] += b;
+    sha->state[2] += c;
+    sha->state[3] += d;
+    sha->state[4] += e;
+    sha->state[5] += f;
+    sha->state[6] += g;
+    sha->state[7] += h;
+}
+
+static void sha256_update(Sha256 *sha, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    sha->length += size;
+    while (size > 0) {
+        size_t take = 64 - sha->used < size ? 64 - sha->used : size;
+        memcpy(sha->block + sha->used, bytes, take);
+        sha->used += take;
+        bytes += take;
+        size -= take;
+        if (sha->used == 64) {
+            sha256_block(sha, sha->block);
+            sha->used = 0;
+        }
+    }
+}
+
+static void sha256_final(Sha256 *sha, unsigned char digest[32]) {
+    uint64_t bits = sha->length * 8;
+    static const unsigned char PAD[64] = {0x80};
+    sha256_update(sha, PAD, sha->used < 56 ? 56 - sha->used : 120 - sha->used);
+    unsigned char length[8];
+    for (int i = 0; i < 8; ++i) {
+        length[i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    sha256_update(sha, length, sizeof(length));
+    for (int i = 0; i < 8; ++i) {
+        digest[4 * i] = (unsigned char)(sha->state[i] >> 24);
+        digest[4 * i + 1] = (unsigned char)(sha->state[i] >> 16);
+        digest[4 * i + 2] = (unsigned char)(sha->state[i] >> 8);
+        digest[4 * i + 3] = (unsigned char)sha->state[i];
+    }
+}
 
-    fprintf(fp, "        <section class=\"panel\" aria-label=\"Highlighted repositories\">\n            <div class=\"panel__header\">\n                <h2>Spotlight Projects</h2>\n                <p>Top repositories ranked by stars and forks.</p>\n            </div>\n            <div class=\"repo-grid\">\n");
-    if (ctx->top_repos.size == 0) {
-        fprintf(fp, "                <p>No repositories to show yet. Keep building!</p>\n");
+static void hmac_sha256(const char *key, const void *data, size_t size, unsigned char mac[32]) {
+    unsigned char pad[64] = {0};
+    size_t key_size = strlen(key);
+    Sha256 sha;
+    if (key_size > sizeof(pad)) {
+        sha256_init(&sha);
+        sha256_update(&sha, key, key_size);
+        sha256_final(&sha, pad);
     } else {
-        for (size_t i = 0; i < ctx->top_repos.size; ++i) {
-            RepoEntry *repo = &ctx->top_repos.items[i];
-            char *nameEsc = html_escape(repo->name);
-            char *descEsc = html_escape(repo->description);
-            char *langEsc = html_escape(repo->language);
-            char *urlEsc = html_escape(repo->url);
-            char *updatedEsc = html_escape(repo->updated_at);
-            fprintf(fp, "                <article class=\"repo-card\">\n                    <header>\n                        <h3><a href=\"%s\" target=\"_blank\" rel=\"noopener\">%s</a></h3>\n                        <span class=\"repo-card__language\">%s</span>\n                    </header>\n", urlEsc, nameEsc, langEsc);
-            if (strlen(repo->description) > 0) {
-                fprintf(fp, "                    <p>%s</p>\n", descEsc);
-            }
-            fprintf(fp, "                    <footer>\n                        <span>⭐ %d</span>\n                        <span>🍴 %d</span>\n", repo->stars, repo->forks);
-            if (strlen(repo->updated_at) >= 10) {
-                fprintf(fp, "                        <span>🡅 %.10s</span>\n", updatedEsc);
-            }
-            fprintf(fp, "                    </footer>\n                </article>\n");
-            free(nameEsc);
-            free(descEsc);
-            free(langEsc);
-            free(urlEsc);
-            free(updatedEsc);
+        memcpy(pad, key, key_size);
+    }
+    for (size_t i = 0; i < sizeof(pad); ++i) pad[i] ^= 0x36;
+    sha256_init(&sha);
+    sha256_update(&sha, pad, sizeof(pad));
+    sha256_update(&sha, data, size);
+    sha256_final(&sha, mac);
+    for (size_t i = 0; i < sizeof(pad); ++i) pad[i] ^= 0x36 ^ 0x5c;
+    sha256_init(&sha);
+    sha256_update(&sha, pad, sizeof(pad));
+    sha256_update(&sha, mac, 32);
+    sha256_final(&sha, mac);
+}
+
+/* Checks an X-Hub-Signature-256 value ("sha256=<hex>") against the body,
+ * comparing every digit so the time taken does not reveal how many
+ * matched. */
+static int webhook_signature_valid(const char *secret, const char *body, size_t size, const char *header) {
+    static const char HEX[] = "0123456789abcdef";
+    if (strncmp(header, "sha256=", 7) != 0 || strlen(header + 7) != 64) return 0;
+    unsigned char mac[32];
+    hmac_sha256(secret, body, size, mac);
+    unsigned difference = 0;
+    for (int i = 0; i < 32; ++i) {
+        difference |= (unsigned)(HEX[mac[i] >> 4] ^ tolower((unsigned char)header[7 + 2 * i]));
+        difference |= (unsigned)(HEX[mac[i] & 15] ^ tolower((unsigned char)header[8 + 2 * i]));
+    }
+    return difference == 0;
+}
+
+/* One webhook event, as the refresh thread applies it. */
+typedef struct {
+    int push;        /* re-fetch the recent contribution calendar */
+    int counted;     /* a public, non-fork repository the totals include */
+    int star_delta;
+    int fork_delta;
+    RepoEntry repo;  /* the repository's state after the event */
+} WebhookUpdate;
+
+/* Folds one event into ctx and moves the repository to its new place in
+ * the top list. For a listed repository the totals move by the difference
+ * from its stored counts, so applying an event twice changes nothing;
+ * otherwise they move by the event's deltas. A repository that just fell
+ * out of the list is only found again by the next full refresh. */
+static void context_apply_update(Context *ctx, const WebhookUpdate *update) {
+    if (!update->counted) return;
+    int star_delta = update->star_delta;
+    int fork_delta = update->fork_delta;
+    RepoList *list = &ctx->top_repos;
+    for (size_t i = 0; i < list->size; ++i) {
+        if (strcmp(list->items[i].name, update->repo.name) == 0) {
+            star_delta = update->repo.stars - list->items[i].stars;
+            fork_delta = update->repo.forks - list->items[i].forks;
+            repo_entry_free(&list->items[i]);
+            memmove(&list->items[i], &list->items[i + 1], (list->size - i - 1) * sizeof(RepoEntry));
+            list->size -= 1;
+            break;
         }
     }
-    fprintf(fp, "            </div>\n        </section>\n");
+    ctx->total_stars += star_delta;
+    ctx->total_forks += fork_delta;
+    repo_top_insert(list, &update->repo, TOP_REPO_LIMIT);
+}
 
-    fprintf(fp, "    </main>\n");
-    fprintf(fp, "    <footer class=\"footer\">\n        <p>Generated on %s by an automated workflow.</p>\n        <p>Source available on <a href=\"https://github.com/%s/Auto-Website\" target=\"_blank\" rel=\"noopener\">GitHub</a>.</p>\n    </footer>\n", ctx->generated_at, loginEsc);
+static void webhook_updates_free(WebhookUpdate *updates, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        repo_entry_free(&updates[i].repo);
+    }
+    free(updates);
+}
 
-    fprintf(fp, "    <script>\n    const languageData = ");
-    write_language_json(fp, &ctx->languages);
-    fprintf(fp, ";\n    const contributionData = ");
-    write_contribution_json(fp, &ctx->contributions);
-    fprintf(fp, ";\n    const palette = ['#5B8FF9','#5AD8A6','#5D7092','#F6BD16','#E8684A','#6DC8EC','#9270CA','#FF9D4D'];\n    function buildLanguageChart(){if(!languageData.length||!window.Chart)return;const ctx=document.getElementById('languageChart');const labels=languageData.map(i=>i.language);const shares=languageData.map(i=>i.share);new Chart(ctx,{type:'doughnut',data:{labels,datasets:[{data:shares,backgroundColor:palette,borderWidth:0}]},options:{plugins:{legend:{display:true,position:'bottom'}}}});}\n    function buildContributionChart(){if(!contributionData.length||!window.Chart)return;const ctx=document.getElementById('contributionChart');const labels=contributionData.map(p=>p.date);const counts=contributionData.map(p=>p.count);new Chart(ctx,{type:'line',data:{labels,datasets:[{label:'Daily contributions',data:counts,borderColor:'#5B8FF9',backgroundColor:'rgba(91,143,249,0.2)',tension:0.3,pointRadius:0,fill:true}]},options:{scales:{x:{ticks:{maxTicksLimit:8}},y:{beginAtZero:true}},plugins:{legend:{display:false}}}});}\n    document.addEventListener('DOMContentLoaded', ()=>{buildLanguageChart();buildContributionChart();});\n    </script>\n");
-    fprintf(fp, "</body>\n</html>\n");
+typedef struct {
+    int fd;
+    size_t slot;   /* index in Server.connections */
+    uint32_t events;
+    char request[SERVE_REQUEST_MAX + 1];
+    size_t received;
+    int eof;       /* the client has finished sending */
+    MemoryBuffer upload;  /* a webhook body, while uploading */
+    size_t upload_size;   /* its Content-Length */
+    int uploading;
+    char event[32];       /* X-GitHub-Event */
+    char signature[80];   /* X-Hub-Signature-256 */
+    char delivery[64];    /* X-GitHub-Delivery */
+    char header[512];
+    size_t header_size; /* nonzero while a response is being sent */
+    Site *site;    /* referenced while body points into it */
+    const char *body;
+    size_t body_size;
+    size_t sent;
+    int keep_alive;
+    time_t last_active;
+} Connection;
 
-    free(nameEsc);
-    free(loginEsc);
-    free(bioEsc);
-    free(locationEsc);
-    free(blogEsc);
-    free(avatarEsc);
+typedef struct {
+    const Options *options;
+    const char *token;
+    const char *secret;  /* GITHUB_WEBHOOK_SECRET with --webhook, else NULL */
+    char login[64];      /* whose repositories' events are applied */
+    int epoll_fd;
+    int listen_fd;
+    int wake_fd;
+    Site *site;
+    Connection **connections;
+    size_t connection_count;
+    size_t connection_capacity;
+    Context ctx;         /* the refresh thread's, once it runs */
+    /* Delivery IDs already queued, so a redelivered event is dropped. */
+    char deliveries[SERVE_WEBHOOK_DELIVERIES][64];
+    size_t delivery_next;
+    /* Shared with the refresh thread. */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int stopping;
+    Site *pending;
+    WebhookUpdate *updates;
+    size_t update_count;
+    size_t update_capacity;
+    time_t updates_due;  /* when the queued events are applied, 0 if none */
+} Server;
 
-    fclose(fp);
+/* Applies queued webhook events to the kept Context and renders it again;
+ * a push also re-fetches the part of the calendar it can change. */
+static Site *serve_apply_updates(Server *server, HttpClient *client, const WebhookUpdate *updates, size_t count) {
+    Context *ctx = &server->ctx;
+    int push = 0;
+    for (size_t i = 0; i < count; ++i) {
+        context_apply_update(ctx, &updates[i]);
+        push |= updates[i].push;
+    }
+    if (push && ctx->kind == CONTEXT_USER && fetch_recent_contributions(client, ctx) != 0) {
+        fprintf(stderr, "Cannot re-fetch the contribution calendar; it updates on the next refresh\n");
+    }
+    context_finalize(ctx);
+    printf("Applied %zu webhook event%s\n", count, count == 1 ? "" : "s");
+    fflush(stdout);
+    return site_build(ctx, server->options);
 }
 
-/* ------------------------------ Entry point ----------------------------- */
+/* Refetches everything every --refresh seconds and applies queued webhook
+ * events once they are SERVE_WEBHOOK_DEBOUNCE seconds old, so a burst of
+ * pushes costs one render. A full refresh supersedes the events queued
+ * before it started; the ones that arrive while it runs may be newer than
+ * what it fetched, so they stay queued for the new Context. */
+static void *serve_refresh_main(void *arg) {
+    Server *server = (Server *)arg;
+    HttpClient client;
+    int have_client = server->secret && http_client_init(&client, server->token) == 0;
+    time_t next_refresh = time(NULL) + server->options->refresh;
+    pthread_mutex_lock(&server->lock);
+    while (!server->stopping) {
+        time_t due = server->updates_due && server->updates_due < next_refresh ? server->updates_due : next_refresh;
+        if (time(NULL) < due) {
+            struct timespec deadline = {due, 0};
+            pthread_cond_timedwait(&server->wake, &server->lock, &deadline);
+            continue;
+        }
+        int full = time(NULL) >= next_refresh || !have_client;
+        WebhookUpdate *updates = NULL;
+        size_t count = 0;
+        size_t superseded = server->update_count;
+        if (!full) {
+            updates = server->updates;
+            count = server->update_count;
+            server->updates = NULL;
+            server->update_count = 0;
+            server->update_capacity = 0;
+            server->updates_due = 0;
+        }
+        pthread_mutex_unlock(&server->lock);
 
-int main(void) {
-    const char *token = getenv("GITHUB_TOKEN");
-    if (!token || strlen(token) == 0) {
-        token = getenv("GH_STATS_TOKEN");
+        Site *site = NULL;
+        if (full) {
+            next_refresh = time(NULL) + server->options->refresh;
+            Context fresh;
+            if (site_fetch(server->options, server->token, &fresh) == 0) {
+                free_context(&server->ctx);
+                server->ctx = fresh;
+                site = site_build(&server->ctx, server->options);
+            } else {
+                fprintf(stderr, "Refresh failed; still serving the previous data\n");
+                superseded = 0;
+            }
+        } else {
+            site = serve_apply_updates(server, &client, updates, count);
+            webhook_updates_free(updates, count);
+        }
+
+        pthread_mutex_lock(&server->lock);
+        if (full && superseded) {
+            for (size_t i = 0; i < superseded; ++i) {
+                repo_entry_free(&server->updates[i].repo);
+            }
+            server->update_count -= superseded;
+            memmove(server->updates, server->updates + superseded, server->update_count * sizeof(WebhookUpdate));
+            if (!server->update_count) server->updates_due = 0;
+        }
+        if (!site) continue;
+        /* The loop has not seen a site that is still pending. */
+        site_release(server->pending);
+        server->pending = site;
+        uint64_t one = 1;
+        if (write(server->wake_fd, &one, sizeof(one)) < 0) perror("eventfd");
     }
-    if (!token || strlen(token) == 0) {
-        fprintf(stderr, "Missing GITHUB_TOKEN or GH_STATS_TOKEN environment variable.\n");
-        return EXIT_FAILURE;
+    pthread_mutex_unlock(&server->lock);
+    if (have_client) http_client_cleanup(&client);
+    return NULL;
+}
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/* Binds "[host]:port", ":port" or "port". */
+static int serve_listen(const char *address) {
+    char host[256] = "";
+    const char *port = address;
+    const char *colon = strrchr(address, ':');
+    if (colon) {
+        size_t length = (size_t)(colon - address);
+        if (length >= 2 && address[0] == '[' && address[length - 1] == ']') {
+            address++;
+            length -= 2;
+        }
+        if (length >= sizeof(host)) length = sizeof(host) - 1;
+        memcpy(host, address, length);
+        host[length] = '\0';
+        port = colon + 1;
     }
-    const char *username = getenv("GITHUB_USERNAME");
-    if (!username || strlen(username) == 0) {
-        fprintf(stderr, "Missing GITHUB_USERNAME environment variable.\n");
-        return EXIT_FAILURE;
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    struct addrinfo *found = NULL;
+    int status = getaddrinfo(host[0] ? host : NULL, port, &hints, &found);
+    if (status != 0) {
+        fprintf(stderr, "Cannot resolve %s: %s\n", address, gai_strerror(status));
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo *candidate = found; candidate; candidate = candidate->ai_next) {
+        fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+        if (fd < 0) continue;
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (bind(fd, candidate->ai_addr, candidate->ai_addrlen) == 0 && listen(fd, SOMAXCONN) == 0 && set_nonblocking(fd) == 0) break;
+        close(fd);
+        fd = -1;
     }
+    freeaddrinfo(found);
+    if (fd < 0) perror(address);
+    return fd;
+}
 
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+static int connection_watch(Server *server, Connection *conn, uint32_t events) {
+    if (conn->events == events) return 0;
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = conn;
+    conn->events = events;
+    return epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+}
 
-    char *payload = build_graphql_payload(username);
-    char *response = http_post_json("https://api.github.com/graphql", token, payload);
-    free(payload);
+static void connection_close(Server *server, Connection *conn) {
+    Connection *last = server->connections[--server->connection_count];
+    server->connections[conn->slot] = last;
+    last->slot = conn->slot;
+    close(conn->fd);
+    site_release(conn->site);
+    free(conn->upload.data);
+    free(conn);
+}
 
-    if (!response) {
-        curl_global_cleanup();
-        return EXIT_FAILURE;
+static void serve_accept(Server *server, time_t now) {
+    for (;;) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+        Connection *conn = (Connection *)xmalloc(sizeof(Connection));
+        memset(conn, 0, sizeof(*conn));
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+        conn->last_active = now;
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = conn;
+        if (set_nonblocking(fd) != 0 || epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            free(conn);
+            continue;
+        }
+        if (server->connection_count == server->connection_capacity) {
+            server->connection_capacity = server->connection_capacity ? server->connection_capacity * 2 : 64;
+            server->connections = (Connection **)realloc(server->connections, server->connection_capacity * sizeof(Connection *));
+            if (!server->connections) {
+                fprintf(stderr, "Out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        conn->slot = server->connection_count;
+        server->connections[server->connection_count++] = conn;
     }
+}
 
-    JsonValue *root = json_parse(response);
-    free(response);
-    if (!root) {
-        curl_global_cleanup();
-        return EXIT_FAILURE;
+/* True when the comma-separated header value lists token with a nonzero
+ * q value. */
+static int header_accepts(const char *value, const char *token) {
+    size_t length = strlen(token);
+    for (const char *p = value; *p;) {
+        while (*p == ' ' || *p == ',') p++;
+        const char *end = p + strcspn(p, ",;");
+        const char *name_end = end;
+        while (name_end > p && name_end[-1] == ' ') name_end--;
+        int match = (size_t)(name_end - p) == length && strncasecmp(p, token, length) == 0;
+        double quality = 1.0;
+        const char *q = end;
+        while (*q == ';') {
+            q++;
+            while (*q == ' ') q++;
+            if (q[0] == 'q' && q[1] == '=') quality = strtod(q + 2, NULL);
+            q += strcspn(q, ",;");
+        }
+        if (match) return quality > 0.0;
+        p = q;
     }
+    return 0;
+}
 
-    JsonValue *dataVal = json_object_get(root, "data");
-    JsonValue *userVal = json_object_get(dataVal, "user");
-    if (!userVal) {
-        fprintf(stderr, "GitHub API response missing user data.\n");
+/* Queues a response. A NULL body (a 304) is sent without Content-Length;
+ * send_body is 0 for HEAD. */
+static void connection_respond(Connection *conn, const char *status, const char *extra, const char *body, size_t body_size, int send_body) {
+    char content_length[48] = "";
+    if (body) snprintf(content_length, sizeof(content_length), "Content-Length: %zu\r\n", body_size);
+    int length = snprintf(conn->header, sizeof(conn->header), "HTTP/1.1 %s\r\n%s%sConnection: %s\r\n\r\n", status, extra, content_length,
+                          conn->keep_alive ? "keep-alive" : "close");
+    conn->header_size = length > 0 && (size_t)length < sizeof(conn->header) ? (size_t)length : 0;
+    conn->body = body;
+    conn->body_size = send_body ? body_size : 0;
+    conn->sent = 0;
+}
+
+static void connection_error(Connection *conn, const char *status, const char *extra) {
+    static const char BODY[] = "See the dashboard at /\n";
+    connection_respond(conn, status, extra, BODY, sizeof(BODY) - 1, 1);
+}
+
+/* Queues a plain-text response; text must be a string literal. */
+static void connection_text(Connection *conn, const char *status, const char *text) {
+    connection_respond(conn, status, "Content-Type: text/plain\r\n", text, strlen(text), 1);
+}
+
+/* True if delivery is one of the recently queued IDs; otherwise remembers
+ * it in place of the oldest. Only the event loop thread calls this. */
+static int webhook_seen(Server *server, const char *delivery) {
+    if (!delivery[0]) return 0;
+    for (size_t i = 0; i < SERVE_WEBHOOK_DELIVERIES; ++i) {
+        if (strcmp(server->deliveries[i], delivery) == 0) return 1;
+    }
+    snprintf(server->deliveries[server->delivery_next], sizeof(server->deliveries[0]), "%s", delivery);
+    server->delivery_next = (server->delivery_next + 1) % SERVE_WEBHOOK_DELIVERIES;
+    return 0;
+}
+
+/* Answers a complete webhook body. Events for other owners' repositories
+ * are acknowledged and dropped, and so is a redelivery of an event that
+ * was already queued. */
+static void webhook_receive(Server *server, Connection *conn) {
+    buffer_reserve(&conn->upload, 0);
+    conn->upload.data[conn->upload.size] = '\0';
+    conn->uploading = 0;
+    if (!webhook_signature_valid(server->secret, conn->upload.data, conn->upload.size, conn->signature)) {
+        connection_text(conn, "401 Unauthorized", "Bad signature\n");
+        return;
+    }
+    int star = strcmp(conn->event, "star") == 0;
+    int fork = strcmp(conn->event, "fork") == 0;
+    int push = strcmp(conn->event, "push") == 0;
+    if (strcmp(conn->event, "ping") == 0) {
+        connection_text(conn, "200 OK", "pong\n");
+        return;
+    }
+    if (!star && !fork && !push) {
+        connection_text(conn, "200 OK", "ignored\n");
+        return;
+    }
+    JsonValue *root = json_parse(conn->upload.data);
+    JsonValue *repo = json_object_get(root, "repository");
+    if (!repo || repo->type != JSON_OBJECT) {
         json_free(root);
-        curl_global_cleanup();
-        return EXIT_FAILURE;
+        connection_text(conn, "400 Bad Request", "Expected a repository event\n");
+        return;
+    }
+    const char *owner = json_get_string(json_object_get(json_object_get(repo, "owner"), "login"), "");
+    if (strcasecmp(owner, server->login) != 0) {
+        json_free(root);
+        connection_text(conn, "200 OK", "ignored\n");
+        return;
     }
 
-    Context ctx;
-    ctx.login = dup_or_empty(json_get_string(json_object_get(userVal, "login"), username));
-    ctx.name = dup_or_empty(json_get_string(json_object_get(userVal, "name"), ctx.login));
-    ctx.avatar_url = dup_or_empty(json_get_string(json_object_get(userVal, "avatarUrl"), ""));
-    ctx.bio = dup_or_empty(json_get_string(json_object_get(userVal, "bio"), ""));
-    ctx.location = dup_or_empty(json_get_string(json_object_get(userVal, "location"), ""));
-    ctx.blog = dup_or_empty(json_get_string(json_object_get(userVal, "websiteUrl"), ""));
-    ctx.followers = (int)json_get_number(json_object_get(json_object_get(userVal, "followers"), "totalCount"), 0);
-    ctx.following = (int)json_get_number(json_object_get(json_object_get(userVal, "following"), "totalCount"), 0);
-    ctx.public_repos = (int)json_get_number(json_object_get(json_object_get(userVal, "repositoriesTotal"), "totalCount"), 0);
-
-    repo_list_init(&ctx.top_repos);
-    language_list_init(&ctx.languages);
-    contribution_list_init(&ctx.contributions);
+    if (webhook_seen(server, conn->delivery)) {
+        json_free(root);
+        connection_text(conn, "200 OK", "duplicate\n");
+        return;
+    }
 
-    JsonValue *reposVal = json_object_get(json_object_get(userVal, "repositories"), "nodes");
-    ctx.total_stars = 0;
-    ctx.total_forks = 0;
-
-    if (reposVal && reposVal->type == JSON_ARRAY) {
-        for (size_t i = 0; i < reposVal->as.array.size; ++i) {
-            JsonValue *repo = reposVal->as.array.items[i];
-            if (!repo || repo->type != JSON_OBJECT) continue;
-            if (json_get_bool(json_object_get(repo, "isFork"), 0)) {
-                continue;
+    WebhookUpdate update;
+    memset(&update, 0, sizeof(update));
+    if (push) {
+        /* Only commits to the default branch count as contributions. */
+        char ref[300];
+        snprintf(ref, sizeof(ref), "refs/heads/%s", json_get_string(json_object_get(repo, "default_branch"), ""));
+        update.push = strcmp(json_get_string(json_object_get(root, "ref"), ""), ref) == 0;
+    } else if (star) {
+        const char *action = json_get_string(json_object_get(root, "action"), "");
+        update.star_delta = strcmp(action, "created") == 0 ? 1 : strcmp(action, "deleted") == 0 ? -1 : 0;
+    } else {
+        update.fork_delta = 1;
+    }
+    update.counted = !json_get_bool(json_object_get(repo, "fork"), 0) && !json_get_bool(json_object_get(repo, "private"), 0);
+    update.repo.name = _strdup(json_get_string(json_object_get(repo, "name"), ""));
+    update.repo.description = _strdup(json_get_string(json_object_get(repo, "description"), ""));
+    update.repo.language = _strdup(json_get_string(json_object_get(repo, "language"), "Unknown"));
+    update.repo.url = _strdup(json_get_string(json_object_get(repo, "html_url"), ""));
+    update.repo.updated_at = _strdup(json_get_string(json_object_get(repo, "updated_at"), ""));
+    update.repo.stars = (int)json_get_number(json_object_get(repo, "stargazers_count"), 0);
+    update.repo.forks = (int)json_get_number(json_object_get(repo, "forks_count"), 0);
+    json_free(root);
+
+    pthread_mutex_lock(&server->lock);
+    if (server->update_count == server->update_capacity) {
+        server->update_capacity = server->update_capacity ? server->update_capacity * 2 : 8;
+        server->updates = (WebhookUpdate *)realloc(server->updates, server->update_capacity * sizeof(WebhookUpdate));
+        if (!server->updates) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    server->updates[server->update_count++] = update;
+    if (!server->updates_due) {
+        server->updates_due = time(NULL) + SERVE_WEBHOOK_DEBOUNCE;
+        pthread_cond_signal(&server->wake);
+    }
+    pthread_mutex_unlock(&server->lock);
+    connection_text(conn, "202 Accepted", "queued\n");
+}
+
+/* Reads more of a webhook body and answers it once complete. Returns -1
+ * if the client hung up first. */
+static int connection_upload(Server *server, Connection *conn) {
+    while (conn->upload.size < conn->upload_size) {
+        size_t wanted = conn->upload_size - conn->upload.size;
+        buffer_reserve(&conn->upload, wanted);
+        ssize_t got = read(conn->fd, conn->upload.data + conn->upload.size, wanted);
+        if (got > 0) {
+            conn->upload.size += (size_t)got;
+        } else if (got == 0) {
+            return -1;
+        } else if (errno != EINTR) {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+    }
+    webhook_receive(server, conn);
+    return 0;
+}
+
+/* Parses the request whose headers end at request + end and queues its
+ * response, then drops it from the buffer. */
+static void connection_answer(Server *server, Connection *conn, size_t end) {
+    char *request = conn->request;
+    request[end] = '\0';
+    const char *if_none_match = "";
+    const char *accept_encoding = "";
+    const char *content_length = NULL;
+    int http10 = 0;
+    int close_requested = 0;
+    int keep_alive_requested = 0;
+    conn->event[0] = '\0';
+    conn->signature[0] = '\0';
+    conn->delivery[0] = '\0';
+
+    char *line_end = strstr(request, "\r\n");
+    if (line_end) *line_end = '\0';
+    char *method = request;
+    char *target = strchr(method, ' ');
+    char *version = target ? strchr(target + 1, ' ') : NULL;
+    if (version) {
+        *target++ = '\0';
+        *version++ = '\0';
+        http10 = strcmp(version, "HTTP/1.0") == 0;
+    }
+    for (char *line = line_end ? line_end + 2 : request + end; line < request + end;) {
+        char *next = strstr(line, "\r\n");
+        if (next) *next = '\0';
+        char *colon = strchr(line, ':');
+        if (colon) {
+            *colon = '\0';
+            char *value = colon + 1;
+            while (*value == ' ' || *value == '\t') value++;
+            if (strcasecmp(line, "If-None-Match") == 0) {
+                if_none_match = value;
+            } else if (strcasecmp(line, "Accept-Encoding") == 0) {
+                accept_encoding = value;
+            } else if (strcasecmp(line, "Connection") == 0) {
+                close_requested = header_accepts(value, "close");
+                keep_alive_requested = header_accepts(value, "keep-alive");
+            } else if (strcasecmp(line, "Content-Length") == 0) {
+                content_length = value;
+            } else if (strcasecmp(line, "X-GitHub-Event") == 0) {
+                snprintf(conn->event, sizeof(conn->event), "%s", value);
+            } else if (strcasecmp(line, "X-Hub-Signature-256") == 0) {
+                snprintf(conn->signature, sizeof(conn->signature), "%s", value);
+            } else if (strcasecmp(line, "X-GitHub-Delivery") == 0) {
+                snprintf(conn->delivery, sizeof(conn->delivery), "%s", value);
+            }
+        }
+        line = next ? next + 2 : request + end;
+    }
+
+    size_t consumed = end + 4;
+    conn->received -= consumed;
+    /* The response only points into the Site, never into the request. */
+    int head = version && strcmp(method, "HEAD") == 0;
+    int get = version && strcmp(method, "GET") == 0;
+    int webhook = version && server->secret && strcmp(method, "POST") == 0 && strcspn(target, "?#") == strlen("/webhook") &&
+                  strncmp(target, "/webhook", strlen("/webhook")) == 0;
+    conn->keep_alive = version && (http10 ? keep_alive_requested : !close_requested);
+    if (!version || (strncmp(version, "HTTP/1.", 7) != 0) || target[0] != '/') {
+        conn->keep_alive = 0;
+        connection_error(conn, "400 Bad Request", "Content-Type: text/plain\r\n");
+    } else if (webhook) {
+        char *digits_end = NULL;
+        unsigned long long length = content_length ? strtoull(content_length, &digits_end, 10) : 0;
+        if (!content_length || digits_end == content_length || *digits_end != '\0') {
+            conn->keep_alive = 0;
+            connection_text(conn, "411 Length Required", "Content-Length required\n");
+        } else if (length > SERVE_WEBHOOK_MAX) {
+            conn->keep_alive = 0;
+            connection_text(conn, "413 Content Too Large", "Payload too large\n");
+        } else {
+            /* Whatever of the body came with the headers moves over; the
+             * rest is read by connection_upload(). */
+            size_t early = conn->received < length ? conn->received : (size_t)length;
+            conn->upload.size = 0;
+            buffer_reserve(&conn->upload, (size_t)length);
+            buffer_append(&conn->upload, request + consumed, early);
+            consumed += early;
+            conn->received -= early;
+            conn->upload_size = (size_t)length;
+            conn->uploading = 1;
+            if (conn->upload.size == conn->upload_size) webhook_receive(server, conn);
+        }
+    } else if (!get && !head) {
+        connection_error(conn, "405 Method Not Allowed", "Allow: GET, HEAD\r\nContent-Type: text/plain\r\n");
+    } else {
+        const SiteFile *file = site_find(server->site, target, strcspn(target, "?#"));
+        if (!file) {
+            connection_error(conn, "404 Not Found", "Content-Type: text/plain\r\n");
+        } else {
+            const SiteVariant *chosen = &file->variants[0];
+            for (size_t k = 1; k < file->variant_count; ++k) {
+                const SiteVariant *variant = &file->variants[k];
+                if (variant->body.size < chosen->body.size && header_accepts(accept_encoding, variant->coding)) chosen = variant;
+            }
+            char extra[256];
+            snprintf(extra, sizeof(extra), "Content-Type: %s\r\nETag: %s\r\nCache-Control: no-cache\r\nVary: Accept-Encoding\r\n%s%s%s", file->type, chosen->etag,
+                     chosen->coding ? "Content-Encoding: " : "", chosen->coding ? chosen->coding : "", chosen->coding ? "\r\n" : "");
+            int fresh = strstr(if_none_match, chosen->etag) != NULL || strcmp(if_none_match, "*") == 0;
+            if (fresh) {
+                connection_respond(conn, "304 Not Modified", extra, NULL, 0, 0);
+            } else {
+                connection_respond(conn, "200 OK", extra, chosen->body.data, chosen->body.size, get);
+                conn->site = server->site;
+                conn->site->refs++;
             }
-            RepoEntry entry;
-            entry.name = dup_or_empty(json_get_string(json_object_get(repo, "name"), ""));
-            entry.description = dup_or_empty(json_get_string(json_object_get(repo, "description"), ""));
-            entry.language = dup_or_empty(json_get_string(json_object_get(json_object_get(repo, "primaryLanguage"), "name"), "Unknown"));
-            entry.url = dup_or_empty(json_get_string(json_object_get(repo, "url"), ""));
-            entry.updated_at = dup_or_empty(json_get_string(json_object_get(repo, "updatedAt"), ""));
-            entry.stars = (int)json_get_number(json_object_get(repo, "stargazerCount"), 0);
-            entry.forks = (int)json_get_number(json_object_get(repo, "forkCount"), 0);
-            ctx.total_stars += entry.stars;
-            ctx.total_forks += entry.forks;
-            repo_list_push(&ctx.top_repos, entry);
+        }
+    }
+    memmove(conn->request, conn->request + consumed, conn->received);
+}
 
-            JsonValue *languageVal = json_object_get(repo, "languages");
-            extract_languages(&ctx.languages, languageVal);
+/* Sends as much of the queued response as the socket takes: 0 when it is
+ * all out, 1 when the socket is full, -1 on error. */
+static int connection_flush(Connection *conn) {
+    size_t total = conn->header_size + conn->body_size;
+    while (conn->sent < total) {
+        struct iovec parts[2];
+        int count = 0;
+        if (conn->sent < conn->header_size) {
+            parts[count].iov_base = conn->header + conn->sent;
+            parts[count++].iov_len = conn->header_size - conn->sent;
+        }
+        size_t body_sent = conn->sent > conn->header_size ? conn->sent - conn->header_size : 0;
+        if (body_sent < conn->body_size) {
+            parts[count].iov_base = (void *)(conn->body + body_sent);
+            parts[count++].iov_len = conn->body_size - body_sent;
+        }
+        ssize_t written = writev(conn->fd, parts, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 1 : -1;
         }
+        conn->sent += (size_t)written;
     }
+    return 0;
+}
+
+/* Finds the blank line ending the request headers; SIZE_MAX while they
+ * are incomplete. */
+static size_t request_header_end(const char *data, size_t size) {
+    for (size_t i = 0; i + 3 < size; ++i) {
+        if (data[i] == '\r' && data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n') return i;
+    }
+    return SIZE_MAX;
+}
 
-    qsort(ctx.top_repos.items, ctx.top_repos.size, sizeof(RepoEntry), compare_repos);
-    if (ctx.top_repos.size > 6) {
-        for (size_t i = 6; i < ctx.top_repos.size; ++i) {
-            RepoEntry *repo = &ctx.top_repos.items[i];
-            free(repo->name);
-            free(repo->description);
-            free(repo->language);
-            free(repo->url);
-            free(repo->updated_at);
+/* Reads what the client sent and answers every complete request in order,
+ * one response at a time. Returns -1 when the connection should close. */
+static int connection_process(Server *server, Connection *conn) {
+    if (conn->uploading && connection_upload(server, conn) != 0) return -1;
+    while (!conn->uploading && !conn->header_size && !conn->eof && conn->received < SERVE_REQUEST_MAX) {
+        ssize_t got = read(conn->fd, conn->request + conn->received, SERVE_REQUEST_MAX - conn->received);
+        if (got > 0) {
+            conn->received += (size_t)got;
+        } else if (got == 0) {
+            conn->eof = 1;
+        } else if (errno != EINTR) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+            break;
+        }
+    }
+    for (;;) {
+        if (conn->header_size) {
+            int status = connection_flush(conn);
+            if (status < 0) return -1;
+            if (status > 0) return connection_watch(server, conn, EPOLLOUT);
+            conn->header_size = 0;
+            site_release(conn->site);
+            conn->site = NULL;
+            if (!conn->keep_alive) return -1;
+        }
+        if (conn->uploading) {
+            return conn->eof ? -1 : connection_watch(server, conn, EPOLLIN);
         }
-        ctx.top_repos.size = 6;
+        size_t end = request_header_end(conn->request, conn->received);
+        if (end == SIZE_MAX && conn->received == SERVE_REQUEST_MAX) {
+            conn->keep_alive = 0;
+            conn->received = 0;
+            connection_error(conn, "431 Request Header Fields Too Large", "Content-Type: text/plain\r\n");
+            continue;
+        }
+        if (end == SIZE_MAX) {
+            return conn->eof ? -1 : connection_watch(server, conn, EPOLLIN);
+        }
+        connection_answer(server, conn, end);
     }
+}
 
-    compute_language_shares(&ctx.languages);
-    qsort(ctx.languages.items, ctx.languages.size, sizeof(LanguageEntry), compare_languages);
+static int run_serve(const Options *options, const char *token) {
+    Server server;
+    memset(&server, 0, sizeof(server));
+    server.options = options;
+    server.token = token;
+    server.secret = options->webhook ? getenv("GITHUB_WEBHOOK_SECRET") : NULL;
+    if (options->cache_dir && ensure_directory(options->cache_dir) != 0) {
+        return EXIT_FAILURE;
+    }
+    if (site_fetch(options, token, &server.ctx) != 0) {
+        return EXIT_FAILURE;
+    }
+    snprintf(server.login, sizeof(server.login), "%s", server.ctx.login);
+    server.site = site_build(&server.ctx, options);
+    server.listen_fd = serve_listen(options->serve);
+    if (server.listen_fd < 0) {
+        site_release(server.site);
+        free_context(&server.ctx);
+        return EXIT_FAILURE;
+    }
+    server.epoll_fd = epoll_create1(0);
+    server.wake_fd = eventfd(0, EFD_NONBLOCK);
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.wake, NULL);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &server.listen_fd;
+    int ready = server.epoll_fd >= 0 && server.wake_fd >= 0 && epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.listen_fd, &event) == 0;
+    event.data.ptr = &server.wake_fd;
+    ready = ready && epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.wake_fd, &event) == 0;
+    pthread_t refresher;
+    ready = ready && pthread_create(&refresher, NULL, serve_refresh_main, &server) == 0;
+    if (!ready) {
+        perror("--serve");
+        close(server.listen_fd);
+        if (server.epoll_fd >= 0) close(server.epoll_fd);
+        if (server.wake_fd >= 0) close(server.wake_fd);
+        pthread_cond_destroy(&server.wake);
+        pthread_mutex_destroy(&server.lock);
+        site_release(server.site);
+        free_context(&server.ctx);
+        return EXIT_FAILURE;
+    }
 
-    JsonValue *calendar = json_object_get(json_object_get(userVal, "contributionsCollection"), "contributionCalendar");
-    ctx.total_contributions = (int)json_get_number(json_object_get(calendar, "totalContributions"), 0);
-    extract_contributions(&ctx.contributions, calendar);
-    trim_contributions(&ctx.contributions, 120);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    printf("Serving %zu files on %s, refreshing every %d s\n", server.site->count, options->serve, options->refresh);
+    if (server.secret) printf("Accepting webhooks for %s's repositories on POST /webhook\n", server.login);
+    fflush(stdout);
 
-    time_t now = time(NULL);
-    struct tm *utc = gmtime(&now);
-    strftime(ctx.generated_at, sizeof(ctx.generated_at), "%Y-%m-%d %H:%M UTC", utc);
+    struct epoll_event events[64];
+    time_t last_sweep = time(NULL);
+    while (!stop_requested) {
+        int count = epoll_wait(server.epoll_fd, events, 64, 1000);
+        if (count < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        time_t now = time(NULL);
+        for (int i = 0; i < count; ++i) {
+            void *source = events[i].data.ptr;
+            if (source == &server.listen_fd) {
+                serve_accept(&server, now);
+            } else if (source == &server.wake_fd) {
+                uint64_t value;
+                if (read(server.wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) perror("eventfd");
+                pthread_mutex_lock(&server.lock);
+                Site *next = server.pending;
+                server.pending = NULL;
+                pthread_mutex_unlock(&server.lock);
+                if (next) {
+                    site_release(server.site);
+                    server.site = next;
+                    printf("Now serving data generated at %s\n", next->generated_at);
+                    fflush(stdout);
+                }
+            } else {
+                Connection *conn = (Connection *)source;
+                conn->last_active = now;
+                if (connection_process(&server, conn) != 0) connection_close(&server, conn);
+            }
+        }
+        /* Keep-alive connections that go quiet, and clients that stop
+         * reading, are dropped. */
+        if (now != last_sweep) {
+            last_sweep = now;
+            for (size_t i = server.connection_count; i-- > 0;) {
+                if (now - server.connections[i]->last_active > SERVE_IDLE_SECONDS) connection_close(&server, server.connections[i]);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&server.lock);
+    server.stopping = 1;
+    pthread_cond_signal(&server.wake);
+    pthread_mutex_unlock(&server.lock);
+    pthread_join(refresher, NULL);
+    while (server.connection_count > 0) {
+        connection_close(&server, server.connections[server.connection_count - 1]);
+    }
+    free(server.connections);
+    webhook_updates_free(server.updates, server.update_count);
+    free_context(&server.ctx);
+    site_release(server.pending);
+    site_release(server.site);
+    close(server.listen_fd);
+    close(server.wake_fd);
+    close(server.epoll_fd);
+    pthread_cond_destroy(&server.wake);
+    pthread_mutex_destroy(&server.lock);
+    printf("Server stopped\n");
+    return EXIT_SUCCESS;
+}
 
-    write_html(&ctx, "docs/index.html");
+#endif
 
-    printf("Site updated for %s -> docs/index.html\n", ctx.login);
+/* ------------------------------ Entry point ----------------------------- */
 
-    free_context(&ctx);
-    json_free(root);
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  (no options)        Render GITHUB_USERNAME into <output-dir>/index.html\n"
+            "  --batch FILE        Render every login listed in FILE (\"-\" for stdin)\n"
+            "                      into <output-dir>/<login>/index.html\n"
+            "  --org LOGIN         Render one dashboard aggregated over every public\n"
+            "                      repository of an organization\n"
+            "  --team NAME         With --batch, also merge every listed user into\n"
+            "                      <output-dir>/teams/NAME/index.html\n"
+            "  --jobs N            Threads that parse and render --batch users while\n"
+            "                      the next requests are in flight (default 4)\n"
+            "  --batch-size N      Users per aliased GraphQL request (default %d,\n"
+            "                      clamped to GitHub's node and cost limits)\n"
+            "  --output-dir DIR    Output root (default docs)\n"
+            "  --save-snapshot P   Also save the computed data as a binary snapshot\n"
+            "                      (a directory of <login>.snap files with --batch)\n"
+            "  --from-snapshot P   Render from a saved snapshot instead of the API\n"
+            "  --no-history        Do not record or chart <output-dir>/history.bin\n"
+            "  --html-only         Skip api/stats.json, card.md and badges/*.svg\n"
+            "  --serve ADDR        Serve the dashboard over HTTP from memory on\n"
+            "                      [host]:port instead of writing files (Linux)\n"
+            "  --daemon            Keep running and rewrite the files on a schedule,\n"
+            "                      reusing connections and memory between refreshes;\n"
+            "                      a --batch line may add its own interval in seconds\n"
+            "  --webhook           With --serve, apply signed push, star and fork\n"
+            "                      webhooks on POST /webhook between refreshes\n"
+            "                      (secret in GITHUB_WEBHOOK_SECRET)\n"
+            "  --refresh SECONDS   How often --serve and --daemon refetch the data\n"
+            "                      (default 3600)\n"
+            "  --cache-dir DIR     Keep rendered page sections in DIR and reuse the\n"
+            "                      ones whose data has not changed\n"
+            "  --precompress       Also write .gz, .br and .zst copies of each page and\n"
+            "                      of assets/styles.css, skipping up-to-date ones\n"
+            "  --chartjs           Load Chart.js to make the inline SVG charts\n"
+            "                      interactive\n"
+            "  --split-data        With --chartjs, load the chart data from a\n"
+            "                      fingerprinted data.<hash>.json beside the page\n"
+            "  --deadline SECONDS  Stop waiting for GitHub after SECONDS; users whose\n"
+            "                      fetch failed are rendered from their last\n"
+            "                      --save-snapshot and marked as stale\n"
+            "  --force             Rewrite pages even when their data is unchanged\n"
+            "  --keep-timestamp    With --force, keep the recorded timestamp on\n"
+            "                      unchanged pages so they stay byte-identical\n"
+            "  --years N           Contribution history to fetch, one concurrent\n"
+            "                      request per year (default 1)\n",
+            program, GRAPHQL_DEFAULT_BATCH);
+}
+
+static int parse_options(int argc, char **argv, Options *options) {
+    options->batch_path = NULL;
+    options->org = NULL;
+    options->team = NULL;
+    options->output_dir = "docs";
+    options->save_snapshot = NULL;
+    options->from_snapshot = NULL;
+    options->cache_dir = NULL;
+    options->history = 1;
+    options->years = 1;
+    options->jobs = 4;
+    options->batch_size = GRAPHQL_DEFAULT_BATCH;
+    options->write_flags = 0;
+    options->precompress = 0;
+    options->outputs = 1;
+    options->serve = NULL;
+    options->daemon = 0;
+    options->webhook = 0;
+    options->refresh = 3600;
+    options->deadline = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            print_usage(argv[0]);
+            return -1;
+        } else if (strcmp(arg, "--batch") == 0 && value) {
+            options->batch_path = value;
+            i++;
+        } else if (strcmp(arg, "--org") == 0 && value) {
+            options->org = value;
+            i++;
+        } else if (strcmp(arg, "--team") == 0 && value) {
+            options->team = value;
+            i++;
+        } else if (strcmp(arg, "--jobs") == 0 && value) {
+            options->jobs = atoi(value);
+            if (options->jobs < 1 || options->jobs > 64) {
+                fprintf(stderr, "--jobs must be between 1 and 64\n");
+                return -1;
+            }
+            i++;
+        } else if (strcmp(arg, "--batch-size") == 0 && value) {
+            options->batch_size = atoi(value);
+            if (options->batch_size < 1) {
+                fprintf(stderr, "--batch-size must be at least 1\n");
+                return -1;
+            }
+            i++;
+        } else if (strcmp(arg, "--save-snapshot") == 0 && value) {
+            options->save_snapshot = value;
+            i++;
+        } else if (strcmp(arg, "--from-snapshot") == 0 && value) {
+            options->from_snapshot = value;
+            i++;
+        } else if (strcmp(arg, "--cache-dir") == 0 && value) {
+            options->cache_dir = value;
+            i++;
+        } else if (strcmp(arg, "--years") == 0 && value) {
+            options->years = atoi(value);
+            if (options->years < 1 || options->years > MAX_CONTRIBUTION_YEARS) {
+                fprintf(stderr, "--years must be between 1 and %d\n", MAX_CONTRIBUTION_YEARS);
+                return -1;
+            }
+            i++;
+        } else if (strcmp(arg, "--precompress") == 0) {
+            if (!ENCODERS[0].suffix) {
+                fprintf(stderr, "--precompress needs zlib, brotli or zstd at build time\n");
+                return -1;
+            }
+            options->precompress = 1;
+        } else if (strcmp(arg, "--chartjs") == 0) {
+            options->write_flags |= WRITE_CHARTJS;
+        } else if (strcmp(arg, "--split-data") == 0) {
+            options->write_flags |= WRITE_SPLIT_DATA;
+        } else if (strcmp(arg, "--force") == 0) {
+            options->write_flags |= WRITE_FORCE;
+        } else if (strcmp(arg, "--keep-timestamp") == 0) {
+            options->write_flags |= WRITE_KEEP_TIMESTAMP;
+        } else if (strcmp(arg, "--serve") == 0 && value) {
+            options->serve = value;
+            ++i;
+        } else if (strcmp(arg, "--refresh") == 0 && value) {
+            options->refresh = atoi(value);
+            if (options->refresh < MIN_REFRESH_SECONDS) {
+                fprintf(stderr, "--refresh must be at least %d seconds.\n", MIN_REFRESH_SECONDS);
+                return -1;
+            }
+            ++i;
+        } else if (strcmp(arg, "--deadline") == 0 && value) {
+            char *end = NULL;
+            double seconds = strtod(value, &end);
+            if (end == value || *end != '\0' || !(seconds > 0.0 && seconds <= 86400.0)) {
+                fprintf(stderr, "--deadline must be a number of seconds greater than 0.\n");
+                return -1;
+            }
+            options->deadline = monotonic_ms() + (long long)(seconds * 1000.0);
+            ++i;
+        } else if (strcmp(arg, "--daemon") == 0) {
+            options->daemon = 1;
+        } else if (strcmp(arg, "--webhook") == 0) {
+            options->webhook = 1;
+        } else if (strcmp(arg, "--html-only") == 0) {
+            options->outputs = 0;
+        } else if (strcmp(arg, "--no-history") == 0) {
+            options->history = 0;
+        } else if (strcmp(arg, "--output-dir") == 0 && value) {
+            options->output_dir = value;
+            i++;
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (parse_options(argc, argv, &options) != 0) {
+        return EXIT_FAILURE;
+    }
+    if (options.batch_path && options.org) {
+        fprintf(stderr, "--batch and --org cannot be combined.\n");
+        return EXIT_FAILURE;
+    }
+    if (options.team && !options.batch_path) {
+        fprintf(stderr, "--team requires --batch.\n");
+        return EXIT_FAILURE;
+    }
+    if (options.team && !is_valid_login(options.team)) {
+        fprintf(stderr, "--team name '%s' may only contain letters, digits and hyphens.\n", options.team);
+        return EXIT_FAILURE;
+    }
+    if ((options.write_flags & WRITE_SPLIT_DATA) && !(options.write_flags & WRITE_CHARTJS)) {
+        fprintf(stderr, "--split-data requires --chartjs; the SVG charts embed no data.\n");
+        return EXIT_FAILURE;
+    }
+    if (options.serve && options.batch_path) {
+        fprintf(stderr, "--serve renders a single dashboard and cannot be combined with --batch.\n");
+        return EXIT_FAILURE;
+    }
+    if (options.deadline && (options.serve || options.daemon || options.from_snapshot)) {
+        fprintf(stderr, "--deadline applies to one-off runs; it cannot be combined with --serve, --daemon or --from-snapshot.\n");
+        return EXIT_FAILURE;
+    }
+    if (options.daemon && (options.serve || options.team || options.from_snapshot)) {
+        fprintf(stderr, "--daemon cannot be combined with --serve, --team or --from-snapshot.\n");
+        return EXIT_FAILURE;
+    }
+    if (options.webhook && (!options.serve || options.from_snapshot)) {
+        fprintf(stderr, "--webhook requires --serve and live data; it cannot be combined with --from-snapshot.\n");
+        return EXIT_FAILURE;
+    }
+    if (options.webhook && (!getenv("GITHUB_WEBHOOK_SECRET") || strlen(getenv("GITHUB_WEBHOOK_SECRET")) == 0)) {
+        fprintf(stderr, "--webhook needs the secret GitHub signs deliveries with in GITHUB_WEBHOOK_SECRET.\n");
+        return EXIT_FAILURE;
+    }
+#ifndef HAVE_EPOLL
+    if (options.serve) {
+        fprintf(stderr, "--serve needs epoll and is only available on Linux.\n");
+        return EXIT_FAILURE;
+    }
+#endif
+
+    const char *token = getenv("GITHUB_TOKEN");
+    if (!token || strlen(token) == 0) {
+        token = getenv("GH_STATS_TOKEN");
+    }
+    if (!options.from_snapshot && (!token || strlen(token) == 0)) {
+        fprintf(stderr, "Missing GITHUB_TOKEN or GH_STATS_TOKEN environment variable.\n");
+        return EXIT_FAILURE;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+#ifdef HAVE_EPOLL
+    int status = options.serve ? run_serve(&options, token) : options.daemon ? run_daemon(&options, token) : options.batch_path ? run_batch(&options, token) : run_single(&options, token);
+#else
+    int status = options.daemon ? run_daemon(&options, token) : options.batch_path ? run_batch(&options, token) : run_single(&options, token);
+#endif
     curl_global_cleanup();
-    return EXIT_SUCCESS;
+    return status;
 }
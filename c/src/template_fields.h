@@ -0,0 +1,146 @@
+/* Names shared by tools/template_compiler.c and the renderer in
+ * github_stats.c. The compiler turns templates/index.html.j2 into a flat
+ * TemplateOp array that refers to lists and fields by these ids; the renderer
+ * resolves the ids against a Context. Adding a name here makes it available
+ * to the template once the renderer knows how to resolve it. */
+#ifndef TEMPLATE_FIELDS_H
+#define TEMPLATE_FIELDS_H
+
+/* X(id, name, item, json): sequences usable in {% for %}, |length and, when
+ * json is 1, |tojson. item is the prefix of the per-item fields below; the
+ * loop variable in the template may have any name. */
+#define TEMPLATE_LISTS(X)                                            \
+    X(LIST_LANGUAGE_SUMMARY, "language_summary", "entry", 1)         \
+    X(LIST_CONTRIBUTION_TRAIL, "contribution_trail", "point", 1)     \
+    X(LIST_WEEKDAYS, "weekdays", "day", 0)                           \
+    X(LIST_MEMBERS, "members", "member", 0)                          \
+    X(LIST_YEAR_WINDOWS, "year_windows", "window", 0)                \
+    X(LIST_TOP_REPOS, "top_repos", "repo", 0)
+
+/* X(id, name, list, json): list is the loop whose current item the field
+ * reads, or LIST_NONE for page-level values. The *_chart fields expand to
+ * inline SVG drawn by the renderer. */
+#define TEMPLATE_FIELDS(X)                                                   \
+    X(FIELD_ASSET_PREFIX, "asset_prefix", LIST_NONE, 0)                      \
+    X(FIELD_GENERATED_AT, "generated_at", LIST_NONE, 0)                      \
+    X(FIELD_IS_USER, "is_user", LIST_NONE, 0)                                \
+    X(FIELD_IS_ORG, "is_org", LIST_NONE, 0)                                  \
+    X(FIELD_IS_TEAM, "is_team", LIST_NONE, 0)                                \
+    X(FIELD_PROFILE_NAME, "profile.name", LIST_NONE, 0)                      \
+    X(FIELD_PROFILE_LOGIN, "profile.login", LIST_NONE, 0)                    \
+    X(FIELD_PROFILE_AVATAR_URL, "profile.avatar_url", LIST_NONE, 0)          \
+    X(FIELD_PROFILE_BIO, "profile.bio", LIST_NONE, 0)                        \
+    X(FIELD_PROFILE_LOCATION, "profile.location", LIST_NONE, 0)              \
+    X(FIELD_PROFILE_BLOG, "profile.blog", LIST_NONE, 0)                      \
+    X(FIELD_STATS_TOTAL_STARS, "stats.total_stars", LIST_NONE, 0)            \
+    X(FIELD_STATS_TOTAL_FORKS, "stats.total_forks", LIST_NONE, 0)            \
+    X(FIELD_STATS_FOLLOWERS, "stats.followers", LIST_NONE, 0)                \
+    X(FIELD_STATS_FOLLOWING, "stats.following", LIST_NONE, 0)                \
+    X(FIELD_STATS_PUBLIC_REPOS, "stats.public_repos", LIST_NONE, 0)          \
+    X(FIELD_STATS_TOTAL_CONTRIBUTIONS, "stats.total_contributions", LIST_NONE, 0) \
+    X(FIELD_ACTIVITY_DAYS, "activity.days", LIST_NONE, 0)                    \
+    X(FIELD_ACTIVITY_ACTIVE_DAYS, "activity.active_days", LIST_NONE, 0)      \
+    X(FIELD_ACTIVITY_LONGEST_STREAK, "activity.longest_streak", LIST_NONE, 0) \
+    X(FIELD_ACTIVITY_CURRENT_STREAK, "activity.current_streak", LIST_NONE, 0) \
+    X(FIELD_ACTIVITY_AVERAGE_7, "activity.average_7", LIST_NONE, 0)          \
+    X(FIELD_ACTIVITY_AVERAGE_30, "activity.average_30", LIST_NONE, 0)        \
+    X(FIELD_ACTIVITY_BUSIEST_WEEKDAY, "activity.busiest_weekday", LIST_NONE, 0) \
+    X(FIELD_ACTIVITY_BUSIEST_SHARE, "activity.busiest_share", LIST_NONE, 0)  \
+    X(FIELD_ACTIVITY_P25, "activity.p25", LIST_NONE, 0)                      \
+    X(FIELD_ACTIVITY_P50, "activity.p50", LIST_NONE, 0)                      \
+    X(FIELD_ACTIVITY_P75, "activity.p75", LIST_NONE, 0)                      \
+    X(FIELD_ACTIVITY_P90, "activity.p90", LIST_NONE, 0)                      \
+    X(FIELD_ACTIVITY_P99, "activity.p99", LIST_NONE, 0)                      \
+    X(FIELD_ACTIVITY_BEST_DATE, "activity.best_date", LIST_NONE, 0)          \
+    X(FIELD_ACTIVITY_BEST_COUNT, "activity.best_count", LIST_NONE, 0)        \
+    X(FIELD_SPARKLINE_WEEKS, "sparkline_weeks", LIST_NONE, 0)                \
+    X(FIELD_SPARKLINE_WIDTH, "sparkline_width", LIST_NONE, 0)                \
+    X(FIELD_HISTORY, "history", LIST_NONE, 1)                                \
+    X(FIELD_HISTORY_SINCE, "history.since", LIST_NONE, 0)                    \
+    X(FIELD_CHARTJS, "chartjs", LIST_NONE, 0)                                \
+    X(FIELD_DATA_URL, "data_url", LIST_NONE, 0)                              \
+    X(FIELD_STALE, "stale", LIST_NONE, 0)                                    \
+    X(FIELD_STALE_CONTRIBUTIONS, "stale_contributions", LIST_NONE, 0)        \
+    X(FIELD_LANGUAGE_CHART, "language_chart", LIST_NONE, 0)                  \
+    X(FIELD_CONTRIBUTION_CHART, "contribution_chart", LIST_NONE, 0)          \
+    X(FIELD_CONTRIBUTION_HEATMAP, "contribution_heatmap", LIST_NONE, 0)      \
+    X(FIELD_HISTORY_CHART, "history_chart", LIST_NONE, 0)                    \
+    X(FIELD_LANGUAGE_DRIFT_CHART, "language_drift_chart", LIST_NONE, 0)      \
+    X(FIELD_ENTRY_LANGUAGE, "entry.language", LIST_LANGUAGE_SUMMARY, 0)      \
+    X(FIELD_ENTRY_SHARE, "entry.share", LIST_LANGUAGE_SUMMARY, 0)            \
+    X(FIELD_ENTRY_BYTES, "entry.bytes", LIST_LANGUAGE_SUMMARY, 0)            \
+    X(FIELD_ENTRY_COLOR, "entry.color", LIST_LANGUAGE_SUMMARY, 0)            \
+    X(FIELD_POINT_DATE, "point.date", LIST_CONTRIBUTION_TRAIL, 0)            \
+    X(FIELD_POINT_COUNT, "point.count", LIST_CONTRIBUTION_TRAIL, 0)          \
+    X(FIELD_DAY_LABEL, "day.label", LIST_WEEKDAYS, 0)                        \
+    X(FIELD_DAY_WIDTH, "day.width", LIST_WEEKDAYS, 0)                        \
+    X(FIELD_DAY_TOTAL, "day.total", LIST_WEEKDAYS, 0)                        \
+    X(FIELD_MEMBER_LOGIN, "member.login", LIST_MEMBERS, 0)                   \
+    X(FIELD_MEMBER_SPARKLINE, "member.sparkline", LIST_MEMBERS, 0)           \
+    X(FIELD_MEMBER_TOTAL, "member.total_contributions", LIST_MEMBERS, 0)     \
+    X(FIELD_WINDOW_FROM, "window.from", LIST_YEAR_WINDOWS, 0)                \
+    X(FIELD_WINDOW_TO, "window.to", LIST_YEAR_WINDOWS, 0)                    \
+    X(FIELD_WINDOW_TOTAL, "window.total", LIST_YEAR_WINDOWS, 0)              \
+    X(FIELD_WINDOW_CHANGE, "window.change", LIST_YEAR_WINDOWS, 0)            \
+    X(FIELD_REPO_NAME, "repo.name", LIST_TOP_REPOS, 0)                       \
+    X(FIELD_REPO_URL, "repo.url", LIST_TOP_REPOS, 0)                         \
+    X(FIELD_REPO_DESCRIPTION, "repo.description", LIST_TOP_REPOS, 0)         \
+    X(FIELD_REPO_LANGUAGE, "repo.language", LIST_TOP_REPOS, 0)               \
+    X(FIELD_REPO_STARS, "repo.stars", LIST_TOP_REPOS, 0)                     \
+    X(FIELD_REPO_FORKS, "repo.forks", LIST_TOP_REPOS, 0)                     \
+    X(FIELD_REPO_UPDATED_ON, "repo.updated_on", LIST_TOP_REPOS, 0)
+
+/* X(id, name, unused, unused): {% block name %} regions the renderer may
+ * cache. Each is keyed on a hash of the data it reads, so the renderer has
+ * to know which inputs belong to which section. */
+#define TEMPLATE_SECTIONS(X)                        \
+    X(SECTION_HERO, "hero", 0, 0)                   \
+    X(SECTION_STATS, "stats", 0, 0)                 \
+    X(SECTION_LANGUAGES, "languages", 0, 0)         \
+    X(SECTION_ACTIVITY, "activity", 0, 0)           \
+    X(SECTION_REPOS, "repos", 0, 0)
+
+#define TEMPLATE_ENUM_ID(id, name, extra, json) id,
+
+typedef enum {
+    TEMPLATE_LISTS(TEMPLATE_ENUM_ID)
+    TEMPLATE_LIST_COUNT,
+    LIST_NONE = TEMPLATE_LIST_COUNT
+} TemplateList;
+
+typedef enum {
+    TEMPLATE_FIELDS(TEMPLATE_ENUM_ID)
+    TEMPLATE_FIELD_COUNT
+} TemplateField;
+
+typedef enum {
+    TEMPLATE_SECTIONS(TEMPLATE_ENUM_ID)
+    TEMPLATE_SECTION_COUNT
+} TemplateSection;
+
+typedef enum {
+    TEMPLATE_OP_TEXT,     /* append text[offset, offset + length) */
+    TEMPLATE_OP_FIELD,    /* append field arg, HTML-escaped unless TEMPLATE_SAFE */
+    TEMPLATE_OP_LENGTH,   /* append the number of items in list arg */
+    TEMPLATE_OP_JSON,     /* append list or field arg as JSON */
+    TEMPLATE_OP_IF,       /* continue if arg is truthy, else jump to offset */
+    TEMPLATE_OP_JUMP,     /* jump to offset */
+    TEMPLATE_OP_FOR,      /* jump to offset if list arg is empty, else enter item 0 */
+    TEMPLATE_OP_ENDFOR,   /* step list arg; jump back to offset while items remain */
+    TEMPLATE_OP_BLOCK,    /* start of section arg; offset is its ENDBLOCK */
+    TEMPLATE_OP_ENDBLOCK  /* end of section arg */
+} TemplateOpcode;
+
+#define TEMPLATE_LIST 0x01   /* arg is a TemplateList, not a TemplateField */
+#define TEMPLATE_NEGATE 0x02 /* {% if not ... %} */
+#define TEMPLATE_SAFE 0x04   /* |safe: skip HTML escaping */
+
+typedef struct {
+    unsigned char op;
+    unsigned char flags;
+    unsigned short arg;
+    unsigned int offset;
+    unsigned int length;
+} TemplateOp;
+
+#endif
@@ -0,0 +1,40 @@
+/* Assertions shared by the tests. Each test includes src/github_stats.c
+ * itself (with its main renamed) so it can call the static functions
+ * directly, and exits nonzero if any CHECK failed. */
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int check_failures = 0;
+
+#define CHECK(condition)                                                    \
+    do {                                                                    \
+        if (!(condition)) {                                                 \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            check_failures++;                                               \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_STR(actual, expected)                                         \
+    do {                                                                    \
+        const char *check_actual = (actual);                                \
+        const char *check_expected = (expected);                            \
+        if (!check_actual || strcmp(check_actual, check_expected) != 0) {   \
+            fprintf(stderr, "%s:%d: CHECK_STR failed: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, \
+                    check_actual ? check_actual : "(null)", check_expected); \
+            check_failures++;                                               \
+        }                                                                   \
+    } while (0)
+
+static int check_report(const char *name) {
+    if (check_failures) {
+        fprintf(stderr, "%s: %d check%s failed\n", name, check_failures, check_failures == 1 ? "" : "s");
+        return 1;
+    }
+    printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,318 @@
+/* Round trip and damage tests for the varint history log (history_append /
+ * history_load). */
+#define main github_stats_main
+#include "github_stats.c"
+#undef main
+
+#include "check.h"
+
+#define HISTORY_TEST_PATH "history_test.bin"
+
+static void history_header(MemoryBuffer *out) {
+    const char version[4] = {HISTORY_VERSION, 0, 0, 0};
+    buffer_append(out, HISTORY_MAGIC, 4);
+    buffer_append(out, version, 4);
+}
+
+static void language_record(MemoryBuffer *out, uint64_t id, const char *name) {
+    buffer_append(out, "\x01", 1);
+    buffer_append_varint(out, id);
+    buffer_append_varint(out, strlen(name));
+    buffer_append(out, name, strlen(name));
+}
+
+/* A row with the five totals' deltas and one (id, bytes delta) pair per
+ * language. */
+static void row_record(MemoryBuffer *out, uint64_t day_delta, const int64_t deltas[5], size_t n, const uint64_t *ids, const int64_t *bytes) {
+    buffer_append(out, "\x02", 1);
+    buffer_append_varint(out, day_delta);
+    for (int c = 0; c < 5; ++c) {
+        buffer_append_zigzag(out, deltas[c]);
+    }
+    buffer_append_varint(out, n);
+    for (size_t k = 0; k < n; ++k) {
+        buffer_append_varint(out, ids[k]);
+        buffer_append_zigzag(out, bytes[k]);
+    }
+}
+
+static void write_bytes(const MemoryBuffer *bytes) {
+    remove(HISTORY_TEST_PATH);
+    CHECK(write_file_atomic(HISTORY_TEST_PATH, bytes->data, bytes->size) == 0);
+}
+
+static size_t file_size(const char *path) {
+    FileView view;
+    if (file_view_open(path, &view) != 0) return 0;
+    size_t size = view.size;
+    file_view_close(&view);
+    return size;
+}
+
+static void sample_context(Context *ctx, int stars, long long c_bytes, long long go_bytes) {
+    context_init(ctx);
+    ctx->login = _strdup("octocat");
+    ctx->total_stars = stars;
+    ctx->total_forks = 12;
+    ctx->followers = 340;
+    ctx->total_contributions = 1500;
+    ctx->public_repos = 25;
+    language_list_add(&ctx->languages, "C", c_bytes);
+    if (go_bytes) language_list_add(&ctx->languages, "Go", go_bytes);
+}
+
+static void check_same_history(const History *a, const History *b) {
+    CHECK(a->rows == b->rows);
+    CHECK(a->language_count == b->language_count);
+    if (a->rows != b->rows || a->language_count != b->language_count) return;
+    for (size_t row = 0; row < a->rows; ++row) {
+        CHECK(a->days[row] == b->days[row]);
+        CHECK(a->stars[row] == b->stars[row]);
+        CHECK(a->forks[row] == b->forks[row]);
+        CHECK(a->followers[row] == b->followers[row]);
+        CHECK(a->contributions[row] == b->contributions[row]);
+        CHECK(a->public_repos[row] == b->public_repos[row]);
+    }
+    for (size_t i = 0; i < a->language_count; ++i) {
+        CHECK_STR(b->languages[i].name, a->languages[i].name);
+        for (size_t row = 0; row < a->rows; ++row) {
+            CHECK(a->languages[i].bytes[row] == b->languages[i].bytes[row]);
+        }
+    }
+}
+
+/* Loads the test file and compares it with the series history_append left
+ * in memory. */
+static void check_file_matches(const History *expected) {
+    History loaded;
+    CHECK(history_load(HISTORY_TEST_PATH, &loaded, NULL) == 0);
+    check_same_history(expected, &loaded);
+    history_free(&loaded);
+}
+
+/* Three days: two crafted rows (today - 3 and today - 1), then today's
+ * appended by history_append. */
+static void sample_log(MemoryBuffer *out, History *expected) {
+    int today = (int)(time(NULL) / 86400);
+    out->size = 0;
+    history_header(out);
+    language_record(out, 0, "C");
+    const int64_t first[5] = {100, 10, 300, 1400, 20};
+    const uint64_t ids[1] = {0};
+    const int64_t first_bytes[1] = {4000};
+    row_record(out, (uint64_t)(today - 3), first, 1, ids, first_bytes);
+    const int64_t second[5] = {-4, 1, 20, 50, 3};
+    const int64_t second_bytes[1] = {-1000};
+    row_record(out, 2, second, 1, ids, second_bytes);
+    write_bytes(out);
+
+    Context ctx;
+    sample_context(&ctx, 97, 3500, 800);
+    CHECK(history_append(HISTORY_TEST_PATH, &ctx) == 0);
+    CHECK(ctx.history.rows == 3);
+    if (ctx.history.rows == 3) {
+        CHECK(ctx.history.days[0] == today - 3);
+        CHECK(ctx.history.days[1] == today - 1);
+        CHECK(ctx.history.days[2] == today);
+        CHECK(ctx.history.stars[1] == 96);
+        CHECK(ctx.history.stars[2] == 97);
+        CHECK(ctx.history.languages[0].bytes[1] == 3000);
+        CHECK(ctx.history.languages[1].bytes[0] == 0);
+        CHECK(ctx.history.languages[1].bytes[2] == 800);
+    }
+    check_file_matches(&ctx.history);
+
+    FileView view;
+    out->size = 0;
+    if (file_view_open(HISTORY_TEST_PATH, &view) == 0) {
+        buffer_append(out, (const char *)view.data, view.size);
+        file_view_close(&view);
+    }
+    *expected = ctx.history;
+    memset(&ctx.history, 0, sizeof(ctx.history));
+    free_context(&ctx);
+}
+
+static void test_append_round_trip(void) {
+    remove(HISTORY_TEST_PATH);
+    Context ctx;
+    sample_context(&ctx, 50, 1000, 200);
+    CHECK(history_append(HISTORY_TEST_PATH, &ctx) == 0);
+    CHECK(ctx.history.rows == 1);
+    check_file_matches(&ctx.history);
+
+    /* The same totals again add nothing. */
+    size_t size = file_size(HISTORY_TEST_PATH);
+    CHECK(history_append(HISTORY_TEST_PATH, &ctx) == 0);
+    CHECK(file_size(HISTORY_TEST_PATH) == size);
+
+    /* A same-day rerun with new totals replaces today's row. */
+    ctx.total_stars = 51;
+    ctx.languages.items[1].bytes = 0;
+    CHECK(history_append(HISTORY_TEST_PATH, &ctx) == 0);
+    CHECK(ctx.history.rows == 1);
+    CHECK(ctx.history.stars[0] == 51);
+    check_file_matches(&ctx.history);
+    free_context(&ctx);
+}
+
+/* Every cut of a log must load as a prefix of its rows, and appending to a
+ * torn log must drop the torn tail first. */
+static void test_truncated(void) {
+    MemoryBuffer log = {0};
+    History full;
+    sample_log(&log, &full);
+    MemoryBuffer prefix = {0};
+    for (size_t size = 1; size < log.size; ++size) {
+        prefix.size = 0;
+        buffer_append(&prefix, log.data, size);
+        write_bytes(&prefix);
+        History loaded;
+        size_t valid_size = 0;
+        int status = history_load(HISTORY_TEST_PATH, &loaded, &valid_size);
+        if (size < HISTORY_HEADER_SIZE) {
+            CHECK(status == -1);
+            continue;
+        }
+        CHECK(status == 0);
+        CHECK(valid_size >= HISTORY_HEADER_SIZE && valid_size <= size);
+        CHECK(loaded.rows <= full.rows);
+        for (size_t row = 0; row < loaded.rows && row < full.rows; ++row) {
+            CHECK(loaded.days[row] == full.days[row]);
+            CHECK(loaded.stars[row] == full.stars[row]);
+            CHECK(loaded.public_repos[row] == full.public_repos[row]);
+        }
+        history_free(&loaded);
+    }
+
+    /* Cut inside today's row: the append replaces the torn bytes. */
+    prefix.size = 0;
+    buffer_append(&prefix, log.data, log.size - 2);
+    write_bytes(&prefix);
+    Context ctx;
+    sample_context(&ctx, 97, 3500, 800);
+    CHECK(history_append(HISTORY_TEST_PATH, &ctx) == 0);
+    check_same_history(&full, &ctx.history);
+    check_file_matches(&full);
+    CHECK(file_size(HISTORY_TEST_PATH) == log.size);
+    free_context(&ctx);
+
+    history_free(&full);
+    free(prefix.data);
+    free(log.data);
+}
+
+static void test_bad_header(void) {
+    MemoryBuffer log = {0};
+    History full;
+    sample_log(&log, &full);
+    history_free(&full);
+    History loaded;
+
+    log.data[0] = 'X';
+    write_bytes(&log);
+    CHECK(history_load(HISTORY_TEST_PATH, &loaded, NULL) == -1);
+    log.data[0] = HISTORY_MAGIC[0];
+    log.data[4] = HISTORY_VERSION + 1;
+    write_bytes(&log);
+    CHECK(history_load(HISTORY_TEST_PATH, &loaded, NULL) == -1);
+
+    /* history_append leaves a store it cannot read alone. */
+    size_t size = file_size(HISTORY_TEST_PATH);
+    Context ctx;
+    sample_context(&ctx, 1, 1, 0);
+    CHECK(history_append(HISTORY_TEST_PATH, &ctx) == -1);
+    CHECK(file_size(HISTORY_TEST_PATH) == size);
+    free_context(&ctx);
+    free(log.data);
+}
+
+/* Appends one damaged record to a good log and checks that loading stops
+ * before it, keeping every earlier row. */
+static void check_damaged_tail(const MemoryBuffer *log, const History *full, const char *tail, size_t tail_size) {
+    MemoryBuffer damaged = {0};
+    buffer_append(&damaged, log->data, log->size);
+    buffer_append(&damaged, tail, tail_size);
+    write_bytes(&damaged);
+    History loaded;
+    size_t valid_size = 0;
+    CHECK(history_load(HISTORY_TEST_PATH, &loaded, &valid_size) == 0);
+    CHECK(valid_size == log->size);
+    check_same_history(full, &loaded);
+    history_free(&loaded);
+    free(damaged.data);
+}
+
+static void test_corrupt_records(void) {
+    MemoryBuffer log = {0};
+    History full;
+    sample_log(&log, &full);
+    MemoryBuffer tail = {0};
+    const int64_t zeros[5] = {0, 0, 0, 0, 0};
+    const uint64_t ids[2] = {0, 7};
+    const int64_t bytes[2] = {0, 0};
+
+    /* An unknown tag. */
+    check_damaged_tail(&log, &full, "\x7f\x00", 2);
+
+    /* A language whose id skips ahead, and one longer than the file. */
+    tail.size = 0;
+    language_record(&tail, 5, "Rust");
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+    tail.size = 0;
+    buffer_append(&tail, "\x01", 1);
+    buffer_append_varint(&tail, full.language_count);
+    buffer_append_varint(&tail, UINT64_MAX);
+    buffer_append(&tail, "Rust", 4);
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+
+    /* A row naming more languages than exist, or an unknown one. */
+    tail.size = 0;
+    row_record(&tail, 1, zeros, 0, ids, bytes);
+    tail.size -= 1;
+    buffer_append_varint(&tail, full.language_count + 1);
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+    tail.size = 0;
+    row_record(&tail, 1, zeros, 2, ids, bytes);
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+
+    /* A varint that never ends. */
+    check_damaged_tail(&log, &full, "\x02\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff", 12);
+
+    /* Deltas that would move a column out of range. */
+    tail.size = 0;
+    row_record(&tail, (uint64_t)INT_MAX, zeros, 0, ids, bytes);
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+    tail.size = 0;
+    row_record(&tail, UINT64_MAX, zeros, 0, ids, bytes);
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+    const int64_t huge[5] = {INT64_MAX, 0, 0, 0, 0};
+    tail.size = 0;
+    row_record(&tail, 1, huge, 0, ids, bytes);
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+    const int64_t low[5] = {0, 0, 0, 0, (int64_t)INT_MIN - 1000};
+    tail.size = 0;
+    row_record(&tail, 1, low, 0, ids, bytes);
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+    const int64_t negative_bytes[1] = {-100000};
+    tail.size = 0;
+    row_record(&tail, 1, zeros, 1, ids, negative_bytes);
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+    const int64_t overflowing_bytes[1] = {INT64_MAX};
+    tail.size = 0;
+    row_record(&tail, 1, zeros, 1, ids, overflowing_bytes);
+    check_damaged_tail(&log, &full, tail.data, tail.size);
+
+    history_free(&full);
+    free(tail.data);
+    free(log.data);
+}
+
+int main(void) {
+    test_append_round_trip();
+    test_truncated();
+    test_bad_header();
+    test_corrupt_records();
+    remove(HISTORY_TEST_PATH);
+    return check_report("history_test");
+}
@@ -0,0 +1,253 @@
+/* Round trip and rejection tests for the binary snapshot format
+ * (write_snapshot / load_snapshot). */
+#define main github_stats_main
+#include "github_stats.c"
+#undef main
+
+#include <stddef.h>
+
+#include "check.h"
+
+#define SNAPSHOT_TEST_PATH "snapshot_test.snap"
+
+static RepoEntry sample_repo(const char *name, const char *description, int stars, int forks) {
+    RepoEntry repo;
+    repo.name = _strdup(name);
+    repo.description = _strdup(description);
+    repo.language = _strdup("C");
+    repo.url = _strdup("https://github.com/octocat/repo");
+    repo.updated_at = _strdup("2026-01-02T03:04:05Z");
+    repo.stars = stars;
+    repo.forks = forks;
+    return repo;
+}
+
+static void sample_context(Context *ctx) {
+    context_init(ctx);
+    ctx->kind = CONTEXT_USER;
+    ctx->login = _strdup("octocat");
+    ctx->name = _strdup("The \"Octo\" Cat <3");
+    ctx->avatar_url = _strdup("https://avatars.example/u/1");
+    ctx->bio = _strdup("");
+    ctx->location = _strdup("Z\xc3\xbcrich");
+    ctx->blog = _strdup("https://octo.example");
+    ctx->followers = 1200;
+    ctx->following = 7;
+    ctx->public_repos = 42;
+    ctx->total_stars = 9001;
+    ctx->total_forks = 314;
+    ctx->total_contributions = 777;
+    snprintf(ctx->generated_at, sizeof(ctx->generated_at), "%s", "2026-10-17 12:00 UTC");
+    repo_list_push(&ctx->top_repos, sample_repo("hello-world", "My first repository", 80, 9));
+    repo_list_push(&ctx->top_repos, sample_repo("dotfiles", "", 3, 0));
+    language_list_add(&ctx->languages, "C", 50000);
+    language_list_add(&ctx->languages, "Shell", 1234);
+    ctx->languages.items[0].share = 97.59;
+    ctx->languages.items[1].share = 2.41;
+    int today = (int)(time(NULL) / 86400);
+    for (int day = today - 400; day <= today; ++day) {
+        contribution_list_set(&ctx->contributions, day, day % 5 == 0 ? 0 : day % 13);
+    }
+}
+
+static void check_same_context(const Context *a, const Context *b) {
+    CHECK(a->kind == b->kind);
+    CHECK_STR(b->login, a->login);
+    CHECK_STR(b->name, a->name);
+    CHECK_STR(b->avatar_url, a->avatar_url);
+    CHECK_STR(b->bio, a->bio);
+    CHECK_STR(b->location, a->location);
+    CHECK_STR(b->blog, a->blog);
+    CHECK_STR(b->generated_at, a->generated_at);
+    CHECK(a->followers == b->followers);
+    CHECK(a->following == b->following);
+    CHECK(a->public_repos == b->public_repos);
+    CHECK(a->total_stars == b->total_stars);
+    CHECK(a->total_forks == b->total_forks);
+    CHECK(a->total_contributions == b->total_contributions);
+
+    CHECK(a->top_repos.size == b->top_repos.size);
+    for (size_t i = 0; i < a->top_repos.size && i < b->top_repos.size; ++i) {
+        const RepoEntry *x = &a->top_repos.items[i];
+        const RepoEntry *y = &b->top_repos.items[i];
+        CHECK_STR(y->name, x->name);
+        CHECK_STR(y->description, x->description);
+        CHECK_STR(y->language, x->language);
+        CHECK_STR(y->url, x->url);
+        CHECK_STR(y->updated_at, x->updated_at);
+        CHECK(x->stars == y->stars);
+        CHECK(x->forks == y->forks);
+    }
+
+    CHECK(a->languages.size == b->languages.size);
+    for (size_t i = 0; i < a->languages.size && i < b->languages.size; ++i) {
+        CHECK_STR(b->languages.items[i].language, a->languages.items[i].language);
+        CHECK(a->languages.items[i].bytes == b->languages.items[i].bytes);
+        CHECK(a->languages.items[i].share == b->languages.items[i].share);
+    }
+
+    CHECK(a->contributions.start_day == b->contributions.start_day);
+    CHECK(a->contributions.size == b->contributions.size);
+    if (a->contributions.size == b->contributions.size) {
+        CHECK(memcmp(a->contributions.counts, b->contributions.counts, a->contributions.size * sizeof(int)) == 0);
+    }
+}
+
+/* Writes bytes as the test snapshot and reports whether loading it failed.
+ * A file that loads anyway is freed so the sanitizers stay quiet. */
+static int snapshot_rejected(const char *bytes, size_t size) {
+    if (write_file_atomic(SNAPSHOT_TEST_PATH, bytes, size) != 0) {
+        fprintf(stderr, "Cannot write %s\n", SNAPSHOT_TEST_PATH);
+        return 0;
+    }
+    Context loaded;
+    if (load_snapshot(SNAPSHOT_TEST_PATH, &loaded) != 0) return 1;
+    free_context(&loaded);
+    return 0;
+}
+
+/* Reads the sample snapshot back as bytes for the corruption tests. */
+static void sample_snapshot(MemoryBuffer *out) {
+    Context ctx;
+    sample_context(&ctx);
+    CHECK(write_snapshot(&ctx, SNAPSHOT_TEST_PATH) == 0);
+    free_context(&ctx);
+    FileView view;
+    out->size = 0;
+    if (file_view_open(SNAPSHOT_TEST_PATH, &view) == 0) {
+        buffer_append(out, (const char *)view.data, view.size);
+        file_view_close(&view);
+    }
+    CHECK(out->size > sizeof(SnapshotHeader));
+}
+
+static SnapshotHeader *header_of(MemoryBuffer *file) {
+    return (SnapshotHeader *)file->data;
+}
+
+static void test_round_trip(void) {
+    Context original;
+    Context loaded;
+    sample_context(&original);
+    CHECK(write_snapshot(&original, SNAPSHOT_TEST_PATH) == 0);
+    CHECK(load_snapshot(SNAPSHOT_TEST_PATH, &loaded) == 0);
+    check_same_context(&original, &loaded);
+    free_context(&loaded);
+
+    /* An organization with no calendar or languages survives as well. */
+    free_context(&original);
+    context_init(&original);
+    original.kind = CONTEXT_ORG;
+    original.login = _strdup("octo-org");
+    CHECK(write_snapshot(&original, SNAPSHOT_TEST_PATH) == 0);
+    CHECK(load_snapshot(SNAPSHOT_TEST_PATH, &loaded) == 0);
+    CHECK(loaded.kind == CONTEXT_ORG);
+    CHECK_STR(loaded.login, "octo-org");
+    CHECK_STR(loaded.name, "");
+    CHECK(loaded.contributions.size == 0);
+    free_context(&loaded);
+    free_context(&original);
+}
+
+static void test_truncated(void) {
+    MemoryBuffer file = {0};
+    sample_snapshot(&file);
+    for (size_t size = 0; size < file.size; ++size) {
+        if (!snapshot_rejected(file.data, size)) {
+            fprintf(stderr, "A snapshot cut to %zu of %zu bytes was accepted\n", size, file.size);
+            check_failures++;
+            break;
+        }
+    }
+    free(file.data);
+}
+
+static void test_bad_header(void) {
+    MemoryBuffer file = {0};
+    sample_snapshot(&file);
+    MemoryBuffer copy = {0};
+
+#define CORRUPT_HEADER(statement)                       \
+    do {                                                \
+        copy.size = 0;                                  \
+        buffer_append(&copy, file.data, file.size);     \
+        SnapshotHeader *header = header_of(&copy);      \
+        statement;                                      \
+        CHECK(snapshot_rejected(copy.data, copy.size)); \
+    } while (0)
+
+    CORRUPT_HEADER(header->magic[0] = 'X');
+    CORRUPT_HEADER(header->version = SNAPSHOT_VERSION + 1);
+    CORRUPT_HEADER(header->header_size = (uint16_t)(sizeof(SnapshotHeader) - 8));
+    CORRUPT_HEADER(header->byte_order = 0x04030201u);
+    CORRUPT_HEADER(header->repos_offset = file.size + 8);
+    CORRUPT_HEADER(header->languages_offset += 4);
+    CORRUPT_HEADER(header->repo_count = UINT32_MAX);
+    CORRUPT_HEADER(header->language_count += 1000);
+    CORRUPT_HEADER(header->contribution_count = UINT32_MAX);
+    CORRUPT_HEADER(header->strings_offset = UINT64_MAX - 7);
+    CORRUPT_HEADER(header->strings_size = 0);
+    CORRUPT_HEADER(header->strings_size += 1);
+#undef CORRUPT_HEADER
+
+    free(copy.data);
+    free(file.data);
+}
+
+static void test_corrupt_records(void) {
+    MemoryBuffer file = {0};
+    sample_snapshot(&file);
+    SnapshotHeader header = *header_of(&file);
+    MemoryBuffer copy = {0};
+    int first_day = days_from_civil(SNAPSHOT_FIRST_YEAR, 1, 1);
+    int today = (int)(time(NULL) / 86400);
+
+#define CORRUPT_RECORD(type, offset, field, value)                  \
+    do {                                                            \
+        copy.size = 0;                                              \
+        buffer_append(&copy, file.data, file.size);                 \
+        ((type *)(copy.data + (offset)))->field = (value);          \
+        CHECK(snapshot_rejected(copy.data, copy.size));             \
+    } while (0)
+
+    size_t contributions = (size_t)header.contributions_offset;
+    size_t last = contributions + (header.contribution_count - 1) * sizeof(SnapshotContribution);
+    CORRUPT_RECORD(SnapshotContribution, contributions, count, -1);
+    CORRUPT_RECORD(SnapshotContribution, last, count, INT32_MIN);
+    CORRUPT_RECORD(SnapshotContribution, contributions, day, first_day - 1);
+    CORRUPT_RECORD(SnapshotContribution, last, day, today + 2);
+    CORRUPT_RECORD(SnapshotContribution, contributions, day, INT32_MIN);
+    CORRUPT_RECORD(SnapshotContribution, last, day, INT32_MAX);
+#undef CORRUPT_RECORD
+
+    /* The string table must end in NUL, or a string could run off the end. */
+    copy.size = 0;
+    buffer_append(&copy, file.data, file.size);
+    copy.data[header.strings_offset + header.strings_size - 1] = 'x';
+    CHECK(snapshot_rejected(copy.data, copy.size));
+
+    /* A string offset past the table reads as "" rather than out of bounds. */
+    copy.size = 0;
+    buffer_append(&copy, file.data, file.size);
+    ((SnapshotRepo *)(copy.data + header.repos_offset))->name = UINT32_MAX;
+    header_of(&copy)->login = (uint32_t)header.strings_size;
+    CHECK(write_file_atomic(SNAPSHOT_TEST_PATH, copy.data, copy.size) == 0);
+    Context loaded;
+    CHECK(load_snapshot(SNAPSHOT_TEST_PATH, &loaded) == 0);
+    CHECK_STR(loaded.login, "");
+    CHECK(loaded.top_repos.size == 2);
+    if (loaded.top_repos.size == 2) CHECK_STR(loaded.top_repos.items[0].name, "");
+    free_context(&loaded);
+
+    free(copy.data);
+    free(file.data);
+}
+
+int main(void) {
+    test_round_trip();
+    test_truncated();
+    test_bad_header();
+    test_corrupt_records();
+    remove(SNAPSHOT_TEST_PATH);
+    return check_report("snapshot_test");
+}
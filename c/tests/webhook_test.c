@@ -0,0 +1,391 @@
+/* Tests for --webhook: the SHA-256 and HMAC code, signature checks, request
+ * parsing in connection_answer / connection_upload, event handling in
+ * webhook_receive and how context_apply_update folds events in. */
+#define main github_stats_main
+#include "github_stats.c"
+#undef main
+
+#include "check.h"
+
+#define WEBHOOK_TEST_SECRET "It's a Secret to Everybody"
+
+static void hex_digest(const unsigned char digest[32], char out[65]) {
+    static const char HEX[] = "0123456789abcdef";
+    for (int i = 0; i < 32; ++i) {
+        out[2 * i] = HEX[digest[i] >> 4];
+        out[2 * i + 1] = HEX[digest[i] & 15];
+    }
+    out[64] = '\0';
+}
+
+static void check_sha256(const char *data, size_t size, size_t repeat, const char *expected) {
+    Sha256 sha;
+    unsigned char digest[32];
+    char hex[65];
+    sha256_init(&sha);
+    for (size_t i = 0; i < repeat; ++i) {
+        sha256_update(&sha, data, size);
+    }
+    sha256_final(&sha, digest);
+    hex_digest(digest, hex);
+    CHECK_STR(hex, expected);
+}
+
+static void check_hmac(const char *key, const char *data, const char *expected) {
+    unsigned char mac[32];
+    char hex[65];
+    hmac_sha256(key, data, strlen(data), mac);
+    hex_digest(mac, hex);
+    CHECK_STR(hex, expected);
+}
+
+/* The "sha256=<hex>" header GitHub would send for body. */
+static void signature_for(const char *body, char out[80]) {
+    unsigned char mac[32];
+    char hex[65];
+    hmac_sha256(WEBHOOK_TEST_SECRET, body, strlen(body), mac);
+    hex_digest(mac, hex);
+    snprintf(out, 80, "sha256=%s", hex);
+}
+
+static void test_sha256(void) {
+    /* FIPS 180-4 examples, including one that needs two padding blocks. */
+    check_sha256("", 0, 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    check_sha256("abc", 3, 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    check_sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56, 1,
+                 "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    check_sha256("aaaaaaaaaa", 10, 100000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    /* RFC 4231 test cases 2 and 6; the second key is longer than a block. */
+    check_hmac("Jefe", "what do ya want for nothing?", "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    char long_key[132];
+    memset(long_key, 0xaa, 131);
+    long_key[131] = '\0';
+    check_hmac(long_key, "Test Using Larger Than Block-Size Key - Hash Key First",
+               "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+}
+
+static void test_signature(void) {
+    const char *body = "Hello, World!";
+    /* GitHub's documented example delivery. */
+    const char *valid = "sha256=757107ea0eb2509fc211221cce984b8a37570b6d7586c22c46f4379c8b043e17";
+    CHECK(webhook_signature_valid(WEBHOOK_TEST_SECRET, body, strlen(body), valid));
+    CHECK(webhook_signature_valid(WEBHOOK_TEST_SECRET, body, strlen(body),
+                                  "sha256=757107EA0EB2509FC211221CCE984B8A37570B6D7586C22C46F4379C8B043E17"));
+    CHECK(!webhook_signature_valid("another secret", body, strlen(body), valid));
+    CHECK(!webhook_signature_valid(WEBHOOK_TEST_SECRET, body, strlen(body) - 1, valid));
+    CHECK(!webhook_signature_valid(WEBHOOK_TEST_SECRET, body, strlen(body), ""));
+    CHECK(!webhook_signature_valid(WEBHOOK_TEST_SECRET, body, strlen(body), valid + 7));
+    CHECK(!webhook_signature_valid(WEBHOOK_TEST_SECRET, body, strlen(body),
+                                   "sha1=757107ea0eb2509fc211221cce984b8a37570b6d7586c22c46f4379c8b043e17"));
+    CHECK(!webhook_signature_valid(WEBHOOK_TEST_SECRET, body, strlen(body),
+                                   "sha256=757107ea0eb2509fc211221cce984b8a37570b6d7586c22c46f4379c8b043e1"));
+    CHECK(!webhook_signature_valid(WEBHOOK_TEST_SECRET, body, strlen(body),
+                                   "sha256=757107ea0eb2509fc211221cce984b8a37570b6d7586c22c46f4379c8b043e177"));
+    char flipped[80];
+    snprintf(flipped, sizeof(flipped), "%s", valid);
+    for (size_t i = 7; flipped[i]; ++i) {
+        char saved = flipped[i];
+        flipped[i] = saved == '0' ? '1' : '0';
+        CHECK(!webhook_signature_valid(WEBHOOK_TEST_SECRET, body, strlen(body), flipped));
+        flipped[i] = saved;
+    }
+}
+
+static void server_init(Server *server) {
+    memset(server, 0, sizeof(*server));
+    server->secret = WEBHOOK_TEST_SECRET;
+    snprintf(server->login, sizeof(server->login), "%s", "alice");
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->wake, NULL);
+}
+
+static void server_free(Server *server) {
+    webhook_updates_free(server->updates, server->update_count);
+    pthread_cond_destroy(&server->wake);
+    pthread_mutex_destroy(&server->lock);
+}
+
+static Connection *connection_new(int fd) {
+    Connection *conn = (Connection *)xmalloc(sizeof(Connection));
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = fd;
+    return conn;
+}
+
+static void connection_free(Connection *conn) {
+    free(conn->upload.data);
+    free(conn);
+}
+
+/* Whether the queued response starts with "HTTP/1.1 <status>". */
+static int responded(const Connection *conn, const char *status) {
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "HTTP/1.1 %s", status);
+    return conn->header_size > 0 && strncmp(conn->header, prefix, strlen(prefix)) == 0;
+}
+
+/* Runs a signed delivery through webhook_receive as if its whole body had
+ * arrived. */
+static void deliver(Server *server, Connection *conn, const char *event, const char *delivery, const char *body, int sign) {
+    snprintf(conn->event, sizeof(conn->event), "%s", event);
+    snprintf(conn->delivery, sizeof(conn->delivery), "%s", delivery);
+    if (sign) {
+        signature_for(body, conn->signature);
+    } else {
+        snprintf(conn->signature, sizeof(conn->signature), "%s", "sha256=0000");
+    }
+    conn->upload.size = 0;
+    buffer_append(&conn->upload, body, strlen(body));
+    conn->upload_size = conn->upload.size;
+    conn->header_size = 0;
+    webhook_receive(server, conn);
+}
+
+static const char STAR_EVENT[] =
+    "{\"action\":\"created\",\"repository\":{\"name\":\"tools\",\"owner\":{\"login\":\"Alice\"},\"fork\":false,\"private\":false,"
+    "\"stargazers_count\":11,\"forks_count\":2,\"language\":\"C\",\"html_url\":\"https://github.com/alice/tools\","
+    "\"updated_at\":\"2026-10-17T00:00:00Z\",\"default_branch\":\"main\"}}";
+
+static void test_receive(void) {
+    Server server;
+    server_init(&server);
+    Connection *conn = connection_new(-1);
+
+    deliver(&server, conn, "star", "d-1", STAR_EVENT, 0);
+    CHECK(responded(conn, "401"));
+    CHECK(server.update_count == 0);
+
+    deliver(&server, conn, "ping", "d-2", "{\"zen\":\"Keep it logically awesome.\"}", 1);
+    CHECK(responded(conn, "200"));
+    deliver(&server, conn, "issues", "d-3", "{}", 1);
+    CHECK(responded(conn, "200"));
+    CHECK(server.update_count == 0);
+
+    deliver(&server, conn, "star", "d-4", "{\"action\":\"created\"", 1);
+    CHECK(responded(conn, "400"));
+    deliver(&server, conn, "star", "d-5", "{\"action\":\"created\",\"repository\":\"tools\"}", 1);
+    CHECK(responded(conn, "400"));
+    deliver(&server, conn, "star", "d-6", "{\"action\":\"created\",\"repository\":{\"name\":\"x\",\"owner\":{\"login\":\"bob\"}}}", 1);
+    CHECK(responded(conn, "200"));
+    CHECK(server.update_count == 0);
+
+    /* Owners match case-insensitively; the event is queued once. */
+    deliver(&server, conn, "star", "d-7", STAR_EVENT, 1);
+    CHECK(responded(conn, "202"));
+    CHECK(server.update_count == 1);
+    CHECK(server.updates_due != 0);
+    deliver(&server, conn, "star", "d-7", STAR_EVENT, 1);
+    CHECK(responded(conn, "200"));
+    CHECK(server.update_count == 1);
+    if (server.update_count == 1) {
+        const WebhookUpdate *update = &server.updates[0];
+        CHECK(update->counted);
+        CHECK(!update->push);
+        CHECK(update->star_delta == 1);
+        CHECK(update->fork_delta == 0);
+        CHECK_STR(update->repo.name, "tools");
+        CHECK(update->repo.stars == 11);
+        CHECK(update->repo.forks == 2);
+    }
+
+    /* Only pushes to the default branch re-fetch the calendar. */
+    deliver(&server, conn, "push", "d-8",
+            "{\"ref\":\"refs/heads/topic\",\"repository\":{\"name\":\"tools\",\"owner\":{\"login\":\"alice\"},\"default_branch\":\"main\"}}", 1);
+    deliver(&server, conn, "push", "d-9",
+            "{\"ref\":\"refs/heads/main\",\"repository\":{\"name\":\"tools\",\"owner\":{\"login\":\"alice\"},\"default_branch\":\"main\"}}", 1);
+    deliver(&server, conn, "fork", "d-10",
+            "{\"forkee\":{},\"repository\":{\"name\":\"tools\",\"owner\":{\"login\":\"alice\"},\"fork\":true}}", 1);
+    CHECK(server.update_count == 4);
+    if (server.update_count == 4) {
+        CHECK(!server.updates[1].push);
+        CHECK(server.updates[2].push);
+        CHECK(server.updates[3].fork_delta == 1);
+        CHECK(!server.updates[3].counted);
+    }
+
+    /* Deliveries without an ID are never treated as repeats. */
+    deliver(&server, conn, "star", "", STAR_EVENT, 1);
+    deliver(&server, conn, "star", "", STAR_EVENT, 1);
+    CHECK(server.update_count == 6);
+
+    /* Only the most recent SERVE_WEBHOOK_DELIVERIES IDs are remembered. */
+    for (int i = 0; i < SERVE_WEBHOOK_DELIVERIES; ++i) {
+        char id[32];
+        snprintf(id, sizeof(id), "later-%d", i);
+        CHECK(!webhook_seen(&server, id));
+    }
+    CHECK(webhook_seen(&server, "later-0"));
+    deliver(&server, conn, "star", "d-7", STAR_EVENT, 1);
+    CHECK(responded(conn, "202"));
+    CHECK(server.update_count == 7);
+
+    connection_free(conn);
+    server_free(&server);
+}
+
+/* Feeds raw request bytes to connection_answer the way the event loop
+ * does once it has seen the end of the headers. */
+static void answer(Server *server, Connection *conn, const char *request) {
+    size_t size = strlen(request);
+    memcpy(conn->request, request, size);
+    conn->received = size;
+    conn->header_size = 0;
+    const char *end = strstr(request, "\r\n\r\n");
+    connection_answer(server, conn, (size_t)(end - request));
+}
+
+static void test_requests(void) {
+    Server server;
+    server_init(&server);
+    Connection *conn = connection_new(-1);
+    char request[SERVE_REQUEST_MAX];
+    char signature[80];
+    signature_for(STAR_EVENT, signature);
+
+    answer(&server, conn, "POST /webhook HTTP/1.1\r\nX-GitHub-Event: star\r\n\r\n");
+    CHECK(responded(conn, "411"));
+    CHECK(!conn->keep_alive);
+    answer(&server, conn, "POST /webhook HTTP/1.1\r\nContent-Length: 12abc\r\n\r\n");
+    CHECK(responded(conn, "411"));
+    answer(&server, conn, "POST /webhook HTTP/1.1\r\nContent-Length: \r\n\r\n");
+    CHECK(responded(conn, "411"));
+    snprintf(request, sizeof(request), "POST /webhook HTTP/1.1\r\nContent-Length: %d\r\n\r\n", SERVE_WEBHOOK_MAX + 1);
+    answer(&server, conn, request);
+    CHECK(responded(conn, "413"));
+    answer(&server, conn, "POST /webhook HTTP/1.1\r\nContent-Length: -1\r\n\r\n");
+    CHECK(responded(conn, "413"));
+    answer(&server, conn, "PUT /webhook HTTP/1.1\r\nContent-Length: 2\r\n\r\n{}");
+    CHECK(responded(conn, "405"));
+    answer(&server, conn, "POST /webhook\r\n\r\n");
+    CHECK(responded(conn, "400"));
+
+    /* Headers are matched case-insensitively and the whole body came with
+     * them. */
+    snprintf(request, sizeof(request),
+             "POST /webhook?x=1 HTTP/1.1\r\ncontent-length: %zu\r\nx-github-event: star\r\nX-GITHUB-DELIVERY: r-1\r\n"
+             "x-hub-signature-256: %s\r\n\r\n%s",
+             strlen(STAR_EVENT), signature, STAR_EVENT);
+    answer(&server, conn, request);
+    CHECK(responded(conn, "202"));
+    CHECK(conn->keep_alive);
+    CHECK(conn->received == 0);
+    CHECK(server.update_count == 1);
+    CHECK_STR(conn->delivery, "r-1");
+
+    /* Without a secret there is no webhook endpoint. */
+    server.secret = NULL;
+    answer(&server, conn, request);
+    CHECK(responded(conn, "405"));
+    server.secret = WEBHOOK_TEST_SECRET;
+
+    /* A body that arrives after the headers is read by connection_upload,
+     * and bytes past Content-Length stay for the next request. */
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    CHECK(set_nonblocking(fds[0]) == 0);
+    conn->fd = fds[0];
+    size_t split = 40;
+    snprintf(request, sizeof(request),
+             "POST /webhook HTTP/1.1\r\nContent-Length: %zu\r\nX-GitHub-Event: star\r\nX-GitHub-Delivery: r-2\r\n"
+             "X-Hub-Signature-256: %s\r\n\r\n%.*s",
+             strlen(STAR_EVENT), signature, (int)split, STAR_EVENT);
+    answer(&server, conn, request);
+    CHECK(conn->uploading);
+    CHECK(conn->header_size == 0);
+    CHECK(conn->upload.size == split);
+    CHECK(connection_upload(&server, conn) == 0);
+    CHECK(conn->uploading);
+    size_t rest = strlen(STAR_EVENT) - split;
+    CHECK(write(fds[1], STAR_EVENT + split, rest) == (ssize_t)rest);
+    CHECK(connection_upload(&server, conn) == 0);
+    CHECK(!conn->uploading);
+    CHECK(responded(conn, "202"));
+    CHECK(server.update_count == 2);
+
+    /* A client that hangs up mid-body is dropped. */
+    snprintf(request, sizeof(request), "POST /webhook HTTP/1.1\r\nContent-Length: 100\r\nX-GitHub-Event: star\r\n\r\n{\"a\":");
+    answer(&server, conn, request);
+    CHECK(conn->uploading);
+    close(fds[1]);
+    CHECK(connection_upload(&server, conn) == -1);
+    close(fds[0]);
+
+    connection_free(conn);
+    server_free(&server);
+}
+
+static RepoEntry repo_entry(const char *name, int stars, int forks) {
+    RepoEntry repo;
+    memset(&repo, 0, sizeof(repo));
+    repo.name = _strdup(name);
+    repo.description = _strdup("");
+    repo.language = _strdup("C");
+    repo.url = _strdup("");
+    repo.updated_at = _strdup("");
+    repo.stars = stars;
+    repo.forks = forks;
+    return repo;
+}
+
+static WebhookUpdate star_update(const char *name, int delta, int stars, int forks) {
+    WebhookUpdate update;
+    memset(&update, 0, sizeof(update));
+    update.counted = 1;
+    update.star_delta = delta;
+    update.repo = repo_entry(name, stars, forks);
+    return update;
+}
+
+static void test_apply_update(void) {
+    Context ctx;
+    context_init(&ctx);
+    ctx.total_stars = 100;
+    ctx.total_forks = 10;
+    RepoEntry listed = repo_entry("tools", 40, 4);
+    repo_top_insert(&ctx.top_repos, &listed, TOP_REPO_LIMIT);
+    repo_entry_free(&listed);
+
+    /* A listed repository moves the totals to match its new counts, so a
+     * repeated event changes nothing. */
+    WebhookUpdate star = star_update("tools", 1, 41, 5);
+    context_apply_update(&ctx, &star);
+    CHECK(ctx.total_stars == 101);
+    CHECK(ctx.total_forks == 11);
+    context_apply_update(&ctx, &star);
+    CHECK(ctx.total_stars == 101);
+    CHECK(ctx.total_forks == 11);
+    CHECK(ctx.top_repos.size == 1);
+
+    /* An unlisted one moves them by the event's delta and joins the list. */
+    WebhookUpdate other = star_update("docs", 1, 3, 0);
+    context_apply_update(&ctx, &other);
+    CHECK(ctx.total_stars == 102);
+    CHECK(ctx.top_repos.size == 2);
+    if (ctx.top_repos.size == 2) {
+        CHECK_STR(ctx.top_repos.items[0].name, "tools");
+        CHECK(ctx.top_repos.items[0].stars == 41);
+        CHECK_STR(ctx.top_repos.items[1].name, "docs");
+    }
+
+    /* Forks and private repositories are not counted. */
+    WebhookUpdate uncounted = star_update("fork", 1, 500, 0);
+    uncounted.counted = 0;
+    context_apply_update(&ctx, &uncounted);
+    CHECK(ctx.total_stars == 102);
+    CHECK(ctx.top_repos.size == 2);
+
+    repo_entry_free(&star.repo);
+    repo_entry_free(&other.repo);
+    repo_entry_free(&uncounted.repo);
+    free_context(&ctx);
+}
+
+int main(void) {
+    test_sha256();
+    test_signature();
+    test_receive();
+    test_requests();
+    test_apply_update();
+    return check_report("webhook_test");
+}
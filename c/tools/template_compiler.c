@@ -0,0 +1,492 @@
+/* Compiles the Jinja subset used by templates/index.html.j2 into a C header
+ * holding one string of literal text and a flat TemplateOp array. Runs at
+ * build time, so the renderer never parses the template.
+ *
+ * Supported: {{ name }}, {{ name.attr }}, filters |e |safe |length |tojson,
+ * {% if [not] x %} / {% elif [not] x %} / {% else %} / {% endif %},
+ * {% for v in list %} / {% endfor %}, top-level {% block name %} /
+ * {% endblock %} around cacheable sections and {# comments #}. Statement
+ * tags get Jinja's trim_blocks and lstrip_blocks treatment so they leave no
+ * blank lines behind.
+ *
+ * Usage: template_compiler TEMPLATE OUTPUT_HEADER */
+#define _CRT_SECURE_NO_WARNINGS
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "template_fields.h"
+
+typedef struct {
+    const char *name;
+    const char *item;
+    int json;
+} ListInfo;
+
+typedef struct {
+    const char *name;
+    int list;
+    int json;
+} FieldInfo;
+
+#define TEMPLATE_LIST_INFO(id, name, item, json) {name, item, json},
+#define TEMPLATE_FIELD_INFO(id, name, list, json) {name, list, json},
+#define TEMPLATE_ID_NAME(id, name, extra, json) #id,
+#define TEMPLATE_NAME(id, name, extra, json) name,
+
+static const ListInfo LISTS[] = {TEMPLATE_LISTS(TEMPLATE_LIST_INFO)};
+static const FieldInfo FIELDS[] = {TEMPLATE_FIELDS(TEMPLATE_FIELD_INFO)};
+static const char *LIST_IDS[] = {TEMPLATE_LISTS(TEMPLATE_ID_NAME)};
+static const char *FIELD_IDS[] = {TEMPLATE_FIELDS(TEMPLATE_ID_NAME)};
+static const char *SECTION_IDS[] = {TEMPLATE_SECTIONS(TEMPLATE_ID_NAME)};
+static const char *SECTION_NAMES[] = {TEMPLATE_SECTIONS(TEMPLATE_NAME)};
+static const char *OPCODE_NAMES[] = {"TEMPLATE_OP_TEXT", "TEMPLATE_OP_FIELD", "TEMPLATE_OP_LENGTH", "TEMPLATE_OP_JSON",
+                                     "TEMPLATE_OP_IF", "TEMPLATE_OP_JUMP", "TEMPLATE_OP_FOR", "TEMPLATE_OP_ENDFOR",
+                                     "TEMPLATE_OP_BLOCK", "TEMPLATE_OP_ENDBLOCK"};
+
+#define MAX_OPS 4096
+#define MAX_DEPTH 32
+#define MAX_BRANCHES 32
+
+typedef struct {
+    int is_for;
+    int is_section;
+    int list;                      /* loop list, or the section id */
+    char var[64];
+    size_t start;                  /* FOR op, or the pending IF op */
+    int pending;                   /* IF op still waiting for its false target */
+    size_t jumps[MAX_BRANCHES];    /* JUMPs to the matching endif */
+    size_t jump_count;
+    int seen_else;
+} Block;
+
+typedef struct {
+    const char *path;
+    int line;
+    TemplateOp ops[MAX_OPS];
+    size_t op_count;
+    char *text;
+    size_t text_size;
+    size_t text_capacity;
+    Block blocks[MAX_DEPTH];
+    size_t depth;
+    size_t label; /* latest jump target; text after it must not merge back */
+    int section_used[TEMPLATE_SECTION_COUNT];
+} Compiler;
+
+static void fail(const Compiler *c, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%s:%d: ", c->path, c->line);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(EXIT_FAILURE);
+}
+
+static size_t emit(Compiler *c, int op, int flags, int arg) {
+    if (c->op_count == MAX_OPS) fail(c, "template too large");
+    TemplateOp *slot = &c->ops[c->op_count];
+    slot->op = (unsigned char)op;
+    slot->flags = (unsigned char)flags;
+    slot->arg = (unsigned short)arg;
+    slot->offset = 0;
+    slot->length = 0;
+    return c->op_count++;
+}
+
+/* Marks the next op as a jump target and returns its index. */
+static unsigned int label(Compiler *c) {
+    c->label = c->op_count;
+    return (unsigned int)c->op_count;
+}
+
+static void emit_text(Compiler *c, const char *text, size_t length) {
+    if (length == 0) return;
+    if (c->text_size + length > c->text_capacity) {
+        while (c->text_size + length > c->text_capacity) {
+            c->text_capacity = c->text_capacity ? c->text_capacity * 2 : 4096;
+        }
+        c->text = (char *)realloc(c->text, c->text_capacity);
+        if (!c->text) fail(c, "out of memory");
+    }
+    memcpy(c->text + c->text_size, text, length);
+    /* Adjacent literal spans collapse into one op. */
+    TemplateOp *last = c->op_count ? &c->ops[c->op_count - 1] : NULL;
+    if (last && c->op_count > c->label && last->op == TEMPLATE_OP_TEXT && last->offset + last->length == c->text_size) {
+        last->length += (unsigned int)length;
+    } else {
+        size_t op = emit(c, TEMPLATE_OP_TEXT, 0, 0);
+        c->ops[op].offset = (unsigned int)c->text_size;
+        c->ops[op].length = (unsigned int)length;
+    }
+    c->text_size += length;
+}
+
+/* Splits s in place into whitespace-separated words. */
+static size_t split_words(char *s, char **words, size_t max) {
+    size_t count = 0;
+    while (*s && count < max) {
+        while (isspace((unsigned char)*s)) s++;
+        if (!*s) break;
+        words[count++] = s;
+        while (*s && !isspace((unsigned char)*s)) s++;
+        if (*s) *s++ = '\0';
+    }
+    return count;
+}
+
+/* Resolves a dotted name to a field or list. Loop variables are rewritten
+ * to the item prefix of the list they iterate. */
+static int resolve_name(Compiler *c, const char *name, int *is_list) {
+    char canonical[128];
+    const char *dot = strchr(name, '.');
+    int scope = LIST_NONE;
+    snprintf(canonical, sizeof(canonical), "%s", name);
+    if (dot) {
+        size_t head = (size_t)(dot - name);
+        for (size_t i = c->depth; i > 0; --i) {
+            const Block *block = &c->blocks[i - 1];
+            if (block->is_for && strlen(block->var) == head && strncmp(block->var, name, head) == 0) {
+                scope = block->list;
+                snprintf(canonical, sizeof(canonical), "%s%s", LISTS[block->list].item, dot);
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < TEMPLATE_FIELD_COUNT; ++i) {
+        if (strcmp(FIELDS[i].name, canonical) == 0 && FIELDS[i].list == scope) {
+            *is_list = 0;
+            return i;
+        }
+    }
+    if (scope == LIST_NONE) {
+        for (int i = 0; i < TEMPLATE_LIST_COUNT; ++i) {
+            if (strcmp(LISTS[i].name, name) == 0) {
+                *is_list = 1;
+                return i;
+            }
+        }
+    }
+    fail(c, "unknown name '%s'", name);
+    return -1;
+}
+
+static void compile_expression(Compiler *c, char *expr) {
+    char *parts[8];
+    size_t count = 0;
+    char *cursor = expr;
+    while (count < 8) {
+        parts[count++] = cursor;
+        char *bar = strchr(cursor, '|');
+        if (!bar) break;
+        *bar = '\0';
+        cursor = bar + 1;
+    }
+    char *words[2];
+    if (split_words(parts[0], words, 2) != 1) fail(c, "expected a single name in {{ }}");
+    int is_list = 0;
+    int id = resolve_name(c, words[0], &is_list);
+
+    int op = TEMPLATE_OP_FIELD;
+    int flags = is_list ? TEMPLATE_LIST : 0;
+    for (size_t i = 1; i < count; ++i) {
+        char *filter[2];
+        if (split_words(parts[i], filter, 2) != 1) fail(c, "malformed filter");
+        if (strcmp(filter[0], "safe") == 0) {
+            flags |= TEMPLATE_SAFE;
+        } else if (strcmp(filter[0], "e") == 0 || strcmp(filter[0], "escape") == 0) {
+            flags &= ~TEMPLATE_SAFE;
+        } else if (strcmp(filter[0], "length") == 0) {
+            if (!is_list) fail(c, "|length needs a list, '%s' is a field", words[0]);
+            op = TEMPLATE_OP_LENGTH;
+        } else if (strcmp(filter[0], "tojson") == 0) {
+            if (!(is_list ? LISTS[id].json : FIELDS[id].json)) fail(c, "'%s' has no JSON form", words[0]);
+            op = TEMPLATE_OP_JSON;
+        } else {
+            fail(c, "unsupported filter '%s'", filter[0]);
+        }
+    }
+    if (op == TEMPLATE_OP_FIELD && is_list) fail(c, "list '%s' needs |length or |tojson", words[0]);
+    emit(c, op, flags, id);
+}
+
+static void emit_condition(Compiler *c, Block *block, char **words, size_t count) {
+    int flags = 0;
+    size_t at = 1;
+    if (at < count && strcmp(words[at], "not") == 0) {
+        flags |= TEMPLATE_NEGATE;
+        at++;
+    }
+    if (at + 1 != count) fail(c, "expected '%s [not] NAME'", words[0]);
+    int is_list = 0;
+    int id = resolve_name(c, words[at], &is_list);
+    if (is_list) flags |= TEMPLATE_LIST;
+    block->start = emit(c, TEMPLATE_OP_IF, flags, id);
+    block->pending = 1;
+}
+
+static void compile_statement(Compiler *c, char *statement) {
+    char *words[8];
+    size_t count = split_words(statement, words, 8);
+    if (count == 0) fail(c, "empty statement");
+    const char *keyword = words[0];
+
+    if (strcmp(keyword, "if") == 0) {
+        if (c->depth == MAX_DEPTH) fail(c, "nesting too deep");
+        Block *block = &c->blocks[c->depth++];
+        memset(block, 0, sizeof(*block));
+        emit_condition(c, block, words, count);
+    } else if (strcmp(keyword, "elif") == 0 || strcmp(keyword, "else") == 0) {
+        Block *block = c->depth ? &c->blocks[c->depth - 1] : NULL;
+        if (!block || block->is_for || block->is_section || block->seen_else) fail(c, "unexpected {%% %s %%}", keyword);
+        if (block->jump_count == MAX_BRANCHES) fail(c, "too many branches");
+        block->jumps[block->jump_count++] = emit(c, TEMPLATE_OP_JUMP, 0, 0);
+        c->ops[block->start].offset = label(c);
+        block->pending = 0;
+        if (keyword[1] == 'l' && keyword[2] == 'i') {
+            emit_condition(c, block, words, count);
+        } else {
+            if (count != 1) fail(c, "{%% else %%} takes no arguments");
+            block->seen_else = 1;
+        }
+    } else if (strcmp(keyword, "endif") == 0) {
+        Block *block = c->depth ? &c->blocks[c->depth - 1] : NULL;
+        if (!block || block->is_for || block->is_section) fail(c, "unexpected {%% endif %%}");
+        if (block->pending) c->ops[block->start].offset = label(c);
+        for (size_t i = 0; i < block->jump_count; ++i) {
+            c->ops[block->jumps[i]].offset = label(c);
+        }
+        c->depth--;
+    } else if (strcmp(keyword, "for") == 0) {
+        if (count != 4 || strcmp(words[2], "in") != 0) fail(c, "expected 'for VAR in LIST'");
+        if (c->depth == MAX_DEPTH) fail(c, "nesting too deep");
+        int is_list = 0;
+        int id = resolve_name(c, words[3], &is_list);
+        if (!is_list) fail(c, "'%s' is not a list", words[3]);
+        Block *block = &c->blocks[c->depth++];
+        memset(block, 0, sizeof(*block));
+        block->is_for = 1;
+        block->list = id;
+        snprintf(block->var, sizeof(block->var), "%s", words[1]);
+        block->start = emit(c, TEMPLATE_OP_FOR, TEMPLATE_LIST, id);
+    } else if (strcmp(keyword, "endfor") == 0) {
+        Block *block = c->depth ? &c->blocks[c->depth - 1] : NULL;
+        if (!block || !block->is_for) fail(c, "unexpected {%% endfor %%}");
+        size_t end = emit(c, TEMPLATE_OP_ENDFOR, TEMPLATE_LIST, block->list);
+        c->ops[end].offset = (unsigned int)(block->start + 1);
+        c->ops[block->start].offset = label(c);
+        c->depth--;
+    } else if (strcmp(keyword, "block") == 0) {
+        if (count != 2) fail(c, "expected 'block NAME'");
+        /* The renderer caches a section as one unit, so it may not start
+         * or end inside a branch or loop. */
+        if (c->depth) fail(c, "{%% block %%} must be at the top level");
+        int id = 0;
+        while (id < TEMPLATE_SECTION_COUNT && strcmp(SECTION_NAMES[id], words[1]) != 0) id++;
+        if (id == TEMPLATE_SECTION_COUNT) fail(c, "unknown section '%s'", words[1]);
+        if (c->section_used[id]++) fail(c, "section '%s' used twice", words[1]);
+        Block *block = &c->blocks[c->depth++];
+        memset(block, 0, sizeof(*block));
+        block->is_section = 1;
+        block->list = id;
+        block->start = emit(c, TEMPLATE_OP_BLOCK, 0, id);
+    } else if (strcmp(keyword, "endblock") == 0) {
+        Block *block = c->depth ? &c->blocks[c->depth - 1] : NULL;
+        if (!block || !block->is_section) fail(c, "unexpected {%% endblock %%}");
+        c->ops[block->start].offset = (unsigned int)emit(c, TEMPLATE_OP_ENDBLOCK, 0, block->list);
+        c->depth--;
+    } else {
+        fail(c, "unsupported statement '%s'", keyword);
+    }
+}
+
+static int count_lines(const char *from, const char *to) {
+    int lines = 0;
+    for (const char *p = from; p < to; ++p) lines += *p == '\n';
+    return lines;
+}
+
+static void compile(Compiler *c, const char *source) {
+    const char *p = source;
+    c->line = 1;
+    while (*p) {
+        const char *tag = strchr(p, '{');
+        while (tag && tag[1] != '{' && tag[1] != '%' && tag[1] != '#') tag = strchr(tag + 1, '{');
+        if (!tag) {
+            emit_text(c, p, strlen(p));
+            break;
+        }
+
+        char kind = tag[1];
+        const char *text_end = tag;
+        if (kind != '{') {
+            /* lstrip_blocks: drop indentation before a statement that
+             * starts its line. */
+            const char *line_start = tag;
+            while (line_start > p && (line_start[-1] == ' ' || line_start[-1] == '\t')) line_start--;
+            if (line_start == source || line_start[-1] == '\n') {
+                text_end = line_start;
+            }
+        }
+        emit_text(c, p, (size_t)(text_end - p));
+        c->line += count_lines(p, tag);
+
+        const char *close = strstr(tag + 2, kind == '{' ? "}}" : kind == '%' ? "%}" : "#}");
+        if (!close) fail(c, "unterminated tag");
+        size_t length = (size_t)(close - (tag + 2));
+        char *body = (char *)malloc(length + 1);
+        if (!body) fail(c, "out of memory");
+        memcpy(body, tag + 2, length);
+        body[length] = '\0';
+        if (kind == '{') {
+            compile_expression(c, body);
+        } else if (kind == '%') {
+            compile_statement(c, body);
+        }
+        free(body);
+        c->line += count_lines(tag, close);
+
+        p = close + 2;
+        /* trim_blocks: a statement swallows the newline that follows it. */
+        if (kind != '{' && *p == '\n') {
+            p++;
+            c->line++;
+        }
+    }
+    if (c->depth) {
+        const Block *open = &c->blocks[c->depth - 1];
+        fail(c, "missing {%% end%s %%}", open->is_for ? "for" : open->is_section ? "block" : "if");
+    }
+}
+
+static void write_c_string(FILE *out, const char *text, size_t length) {
+    fprintf(out, "    \"");
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char ch = (unsigned char)text[i];
+        if (ch == '\n') {
+            fprintf(out, "\\n\"\n");
+            if (i + 1 < length) fprintf(out, "    \"");
+            continue;
+        }
+        if (ch == '"' || ch == '\\') {
+            fprintf(out, "\\%c", ch);
+        } else if (ch == '?') {
+            fprintf(out, "\\?");
+        } else if (ch < 0x20 || ch >= 0x7f) {
+            fprintf(out, "\\%03o", ch);
+        } else {
+            fputc(ch, out);
+        }
+    }
+    if (length == 0 || text[length - 1] != '\n') fprintf(out, "\"\n");
+}
+
+/* 64-bit FNV-1a over the literal text and the op array. */
+static unsigned long long template_digest(const Compiler *c) {
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < c->text_size; ++i) {
+        hash = (hash ^ (unsigned char)c->text[i]) * 0x100000001b3ULL;
+    }
+    for (size_t i = 0; i < c->op_count; ++i) {
+        const TemplateOp *op = &c->ops[i];
+        unsigned long long fields[5] = {op->op, op->flags, op->arg, op->offset, op->length};
+        for (size_t j = 0; j < 5; ++j) {
+            hash = (hash ^ fields[j]) * 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+/* Folds the bytes of the file at path into *hash with FNV-1a. */
+static int digest_file(const char *path, unsigned long long *hash) {
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+    int ch;
+    while ((ch = fgetc(in)) != EOF) {
+        *hash = (*hash ^ (unsigned char)ch) * 0x100000001b3ULL;
+    }
+    fclose(in);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s TEMPLATE OUTPUT_HEADER [RENDERER_SOURCE...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+    size_t size = 0;
+    size_t capacity = 16384;
+    char *source = (char *)malloc(capacity);
+    size_t got;
+    while (source && (got = fread(source + size, 1, capacity - size - 1, in)) > 0) {
+        size += got;
+        if (capacity - size - 1 == 0) {
+            capacity *= 2;
+            source = (char *)realloc(source, capacity);
+        }
+    }
+    fclose(in);
+    if (!source) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    source[size] = '\0';
+
+    /* The renderer sources write much of each section in C (charts,
+     * heatmap, number formats), so their text is part of the cache key too. */
+    unsigned long long renderer_digest = 0xcbf29ce484222325ULL;
+    for (int i = 3; i < argc; ++i) {
+        if (digest_file(argv[i], &renderer_digest) != 0) return EXIT_FAILURE;
+    }
+
+    static Compiler compiler;
+    compiler.path = argv[1];
+    compile(&compiler, source);
+    free(source);
+
+    FILE *out = fopen(argv[2], "w");
+    if (!out) {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+    const char *base = strrchr(argv[1], '/');
+    fprintf(out, "/* Generated by template_compiler from %s. Do not edit. */\n\n", base ? base + 1 : argv[1]);
+    fprintf(out, "static const char TEMPLATE_TEXT[] =\n");
+    write_c_string(out, compiler.text ? compiler.text : "", compiler.text_size);
+    fprintf(out, "    ;\n\nstatic const TemplateOp TEMPLATE_OPS[] = {\n");
+    for (size_t i = 0; i < compiler.op_count; ++i) {
+        const TemplateOp *op = &compiler.ops[i];
+        const char *arg = "0";
+        if (op->op == TEMPLATE_OP_BLOCK || op->op == TEMPLATE_OP_ENDBLOCK) {
+            arg = SECTION_IDS[op->arg];
+        } else if (op->op != TEMPLATE_OP_TEXT && op->op != TEMPLATE_OP_JUMP) {
+            arg = (op->flags & TEMPLATE_LIST) ? LIST_IDS[op->arg] : FIELD_IDS[op->arg];
+        }
+        fprintf(out, "    {%s, %u, %s, %u, %u},\n", OPCODE_NAMES[op->op], op->flags, arg, op->offset, op->length);
+    }
+    fprintf(out, "};\n\n#define TEMPLATE_OP_COUNT %zu\n", compiler.op_count);
+    /* Together these identify the template and the renderer that fills it;
+     * the section cache key covers both, so cached sections rendered by an
+     * older build are never reused. */
+    fprintf(out, "#define TEMPLATE_DIGEST 0x%016llxULL\n", (unsigned long long)template_digest(&compiler));
+    fprintf(out, "#define RENDERER_DIGEST 0x%016llxULL\n", renderer_digest);
+    free(compiler.text);
+
+    if (fclose(out) != 0) {
+        perror(argv[2]);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}